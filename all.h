@@ -12,6 +12,28 @@ typedef enum{
    TRUE   = 1,
 }boolean;
 
+// Address and counter widths. The default build keeps the 32 bit layout
+// the val traces were made with. make BITS=64 (-DDS_64) widens addresses,
+// cycles, sequence numbers and statistics for traces past 2^31
+// instructions with 48 bit virtual addresses
+#ifdef DS_64
+typedef long long              addrT;
+typedef unsigned long long     uaddrT;
+typedef long long              countT;
+typedef unsigned long long     ucountT;
+#define ADDR_BITS              64
+#define PRIaddr                "llx"
+#define PRIcount               "lld"
+#else
+typedef int                    addrT;
+typedef unsigned int           uaddrT;
+typedef int                    countT;
+typedef unsigned int           ucountT;
+#define ADDR_BITS              32
+#define PRIaddr                "x"
+#define PRIcount               "d"
+#endif
+
 // An assert block is all that we need
 #define ASSERT( condition, statement, ... ) if( condition ) { \
    printf( "[ASSERT] In File: %s, Line: %d => " #statement "\n", __FILE__, __LINE__, ##__VA_ARGS__ ); \
@@ -14,6 +14,10 @@
 *H***********************************************************************/
 
 #include "cache.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CACHE_X86
+#endif
 
 // Since this is a small proj, add all utils in this
 // file instead of a separate file
@@ -24,20 +28,27 @@
 #define CLOG2(A)     ceil( LOG2(A) )
 
 // Creates a mask with lower nBits set to 1
-int  utilCreateMask( int nBits )
+addrT utilCreateMask( int nBits )
 {
-   int mask = 0, index;
+   uaddrT mask = 0;
+   int index;
    for( index=0; index<nBits; index++ )
-      mask |= 1 << index;
+      mask |= (uaddrT) 1 << index;
 
-   return mask;
+   return (addrT) mask;
 }
 
-int utilShiftAndMask( int input, int shiftValue, int mask )
+addrT utilShiftAndMask( addrT input, int shiftValue, addrT mask )
 {
    return (input >> shiftValue) & mask;
 }
 
+// Slot of a way in the per way tag store arrays
+#define CACHE_SLOT( cacheP, index, setIndex )   ( (index) * (cacheP)->assoc + (setIndex) )
+// Word and bit of a way in the per set valid/dirty masks
+#define CACHE_WORD( cacheP, index, setIndex )   ( (index) * (cacheP)->maskWords + ( (setIndex) >> 6 ) )
+#define CACHE_BIT( setIndex )                   ( 1ULL << ( (setIndex) & 63 ) )
+
 //-------------- UTILITY END   -----------------
 
 // Allocates and inits all internal variables
@@ -77,20 +88,50 @@ cachePT  cacheInit(
    cacheP->indexMask      = utilCreateMask( cacheP->indexSize )  & ADDRESS_MASK;
    cacheP->tagMask        = utilCreateMask( cacheP->tagSize )    & ADDRESS_MASK;
 
-   // Create the tag store. Calloc it so that we have 0s set (including valid, dirty bit)
-   cacheP->tagStoreP      = (tagStorePT*) calloc(cacheP->nSets, sizeof(tagStorePT));
-   for( int index = 0; index < cacheP->nSets; index++ ){
-       cacheP->tagStoreP[index]                             = (tagStorePT) calloc(1, sizeof(tagStoreT));
-       cacheP->tagStoreP[index]->rowP                       = (tagPT*) calloc(cacheP->assoc, sizeof(tagPT));
-       for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-          cacheP->tagStoreP[index]->rowP[setIndex]          = (tagPT)  calloc(1, sizeof(tagT));
-
-          // Update the counter values to comply with LRU and LFU defaults
-          if( cacheP->repPolicy == POLICY_REP_LRU )
-             cacheP->tagStoreP[index]->rowP[setIndex]->counter = setIndex;
-          else
-             cacheP->tagStoreP[index]->rowP[setIndex]->counter = 0;
-       }
+   // Create the tag store. Calloc it so that we have 0s set (including valid, dirty bit).
+   // Nothing below writes the per set arrays, large ones come straight
+   // from zero filled mappings and only pages of sets in use get touched
+   int numSlots           = cacheP->nSets * cacheP->assoc;
+   cacheP->maskWords      = ( cacheP->assoc + 63 ) / 64;
+   cacheP->tagP           = (addrT*) calloc( numSlots, sizeof(addrT) );
+   cacheP->counterP       = (countT*) calloc( numSlots, sizeof(countT) );
+   cacheP->crfP           = ( repPolicy == POLICY_REP_LRFU ) ? (double*) calloc( numSlots, sizeof(double) ) : NULL;
+   cacheP->validP         = (unsigned long long*) calloc( cacheP->nSets * cacheP->maskWords, sizeof(unsigned long long) );
+   cacheP->dirtyP         = (unsigned long long*) calloc( cacheP->nSets * cacheP->maskWords, sizeof(unsigned long long) );
+   cacheP->countSetP      = (countT*) calloc( cacheP->nSets, sizeof(countT) );
+   ASSERT( !cacheP->tagP || !cacheP->counterP || !cacheP->validP || !cacheP->dirtyP || !cacheP->countSetP ||
+           ( repPolicy == POLICY_REP_LRFU && !cacheP->crfP ), "Unable to allocate tag store of %s", name );
+
+   cacheSelectMatch( cacheP );
+
+   // Recency lists are filled in per set by cacheInitSetLRU
+   if( cacheP->repPolicy == POLICY_REP_LRU ){
+      ASSERT( cacheP->assoc > 65536, "LRU supports at most 65536 ways, %s has %d", name, cacheP->assoc );
+      cacheP->lruNextP    = (unsigned short*) malloc( numSlots * sizeof(unsigned short) );
+      cacheP->lruPrevP    = (unsigned short*) malloc( numSlots * sizeof(unsigned short) );
+      cacheP->lruHeadP    = (unsigned short*) malloc( cacheP->nSets * sizeof(unsigned short) );
+      cacheP->lruTailP    = (unsigned short*) malloc( cacheP->nSets * sizeof(unsigned short) );
+      cacheP->lruTouchedP = (unsigned long long*) calloc( ( cacheP->nSets + 63 ) / 64, sizeof(unsigned long long) );
+      ASSERT( !cacheP->lruNextP || !cacheP->lruPrevP || !cacheP->lruHeadP || !cacheP->lruTailP || !cacheP->lruTouchedP,
+              "Unable to allocate LRU lists of %s", name );
+   }
+
+   // Tree needs a full binary tree over the ways
+   if( cacheP->repPolicy == POLICY_REP_PLRU ){
+      ASSERT( ( cacheP->assoc & ( cacheP->assoc - 1 ) ) != 0, "PLRU needs a power of 2 assoc, %s has %d", name, cacheP->assoc );
+      cacheP->plruP       = (unsigned long long*) calloc( cacheP->nSets * cacheP->maskWords, sizeof(unsigned long long) );
+      ASSERT( !cacheP->plruP, "Unable to allocate PLRU bits of %s", name );
+   }
+
+   // Decay tables, the only place LRFU calls pow
+   if( cacheP->repPolicy == POLICY_REP_LRFU ){
+      cacheP->decayP      = (double*) malloc( CACHE_DECAY_LEVELS * CACHE_DECAY_SIZE * sizeof(double) );
+      ASSERT( !cacheP->decayP, "Unable to allocate LRFU decay tables of %s", name );
+      for( int level = 0; level < CACHE_DECAY_LEVELS; level++ ){
+         double step      = ldexp( 1.0, level * CACHE_DECAY_BITS );
+         for( int digit = 0; digit < CACHE_DECAY_SIZE; digit++ )
+            cacheP->decayP[ level * CACHE_DECAY_SIZE + digit ] = pow( 0.5, lambda * digit * step );
+      }
    }
    
    // Initialize timing params. Only one time compute
@@ -100,6 +141,247 @@ cachePT  cacheInit(
    return cacheP;
 }
 
+// Frees the tag store and the victim cache. Next level is left alone
+void cacheDestroy( cachePT cacheP )
+{
+   if( cacheP == NULL ) return;
+   free( cacheP->tagP );
+   free( cacheP->counterP );
+   free( cacheP->crfP );
+   free( cacheP->validP );
+   free( cacheP->dirtyP );
+   free( cacheP->countSetP );
+   free( cacheP->lruNextP );
+   free( cacheP->lruPrevP );
+   free( cacheP->lruHeadP );
+   free( cacheP->lruTailP );
+   free( cacheP->lruTouchedP );
+   free( cacheP->plruP );
+   free( cacheP->decayP );
+   cacheDestroy( cacheP->victimP );
+   free( cacheP );
+}
+
+// Empty cache with the same configuration. No victim cache or next level
+cachePT cacheClone( cachePT cacheP )
+{
+   return cacheInit( cacheP->name, cacheP->size, cacheP->assoc, cacheP->blockSize, cacheP->lambda,
+                     cacheP->repPolicy, cacheP->writePolicy, NULL );
+}
+
+// Copies sets index % numShards == shard of shardP into cacheP and adds
+// up the statistics. A shard only ever saw its own sets, so with every
+// shard merged cacheP is what one cache seeing all accesses would hold.
+// Sets nothing was ever placed in are still in their initial state
+void cacheMergeShard( cachePT cacheP, cachePT shardP, int shard, int numShards )
+{
+   ASSERT( shardP->nSets != cacheP->nSets || shardP->assoc != cacheP->assoc || shardP->repPolicy != cacheP->repPolicy,
+           "Shard of %s does not match its configuration", cacheP->name );
+   int assoc                   = cacheP->assoc;
+   int maskWords               = cacheP->maskWords;
+   for( int index = shard; index < cacheP->nSets; index += numShards ){
+      int word0                = CACHE_WORD( cacheP, index, 0 );
+      boolean used             = FALSE;
+      for( int word = 0; word < maskWords; word++ )
+         used                 |= ( shardP->validP[ word0 + word ] != 0 );
+      if( !used ) continue;
+
+      int slot0                = CACHE_SLOT( cacheP, index, 0 );
+      memcpy( cacheP->tagP + slot0, shardP->tagP + slot0, assoc * sizeof(addrT) );
+      memcpy( cacheP->counterP + slot0, shardP->counterP + slot0, assoc * sizeof(countT) );
+      memcpy( cacheP->validP + word0, shardP->validP + word0, maskWords * sizeof(unsigned long long) );
+      memcpy( cacheP->dirtyP + word0, shardP->dirtyP + word0, maskWords * sizeof(unsigned long long) );
+      cacheP->countSetP[index] = shardP->countSetP[index];
+      if( cacheP->crfP )
+         memcpy( cacheP->crfP + slot0, shardP->crfP + slot0, assoc * sizeof(double) );
+      if( cacheP->plruP )
+         memcpy( cacheP->plruP + word0, shardP->plruP + word0, maskWords * sizeof(unsigned long long) );
+      if( cacheP->lruTouchedP && ( shardP->lruTouchedP[ index >> 6 ] & CACHE_BIT( index ) ) ){
+         memcpy( cacheP->lruNextP + slot0, shardP->lruNextP + slot0, assoc * sizeof(unsigned short) );
+         memcpy( cacheP->lruPrevP + slot0, shardP->lruPrevP + slot0, assoc * sizeof(unsigned short) );
+         cacheP->lruHeadP[index]              = shardP->lruHeadP[index];
+         cacheP->lruTailP[index]              = shardP->lruTailP[index];
+         cacheP->lruTouchedP[ index >> 6 ]   |= CACHE_BIT( index );
+      }
+   }
+
+   cacheP->readHitCount       += shardP->readHitCount;
+   cacheP->readMissCount      += shardP->readMissCount;
+   cacheP->writeHitCount      += shardP->writeHitCount;
+   cacheP->writeMissCount     += shardP->writeMissCount;
+   cacheP->writeBackCount     += shardP->writeBackCount;
+   cacheP->swaps              += shardP->swaps;
+   cacheP->numAccess          += shardP->numAccess;
+}
+
+// Tag store bit accessors
+inline boolean cacheIsValid( cachePT cacheP, int index, int setIndex )
+{
+   return ( cacheP->validP[ CACHE_WORD( cacheP, index, setIndex ) ] & CACHE_BIT( setIndex ) ) ? TRUE : FALSE;
+}
+
+inline boolean cacheIsDirty( cachePT cacheP, int index, int setIndex )
+{
+   return ( cacheP->dirtyP[ CACHE_WORD( cacheP, index, setIndex ) ] & CACHE_BIT( setIndex ) ) ? TRUE : FALSE;
+}
+
+inline void cacheSetValid( cachePT cacheP, int index, int setIndex, boolean valid )
+{
+   unsigned long long* wordP  = &cacheP->validP[ CACHE_WORD( cacheP, index, setIndex ) ];
+   *wordP                     = ( valid ) ? ( *wordP | CACHE_BIT( setIndex ) ) : ( *wordP & ~CACHE_BIT( setIndex ) );
+}
+
+inline void cacheSetDirty( cachePT cacheP, int index, int setIndex, boolean dirty )
+{
+   unsigned long long* wordP  = &cacheP->dirtyP[ CACHE_WORD( cacheP, index, setIndex ) ];
+   *wordP                     = ( dirty ) ? ( *wordP | CACHE_BIT( setIndex ) ) : ( *wordP & ~CACHE_BIT( setIndex ) );
+}
+
+//-------------- TAG MATCH BEGIN ---------------
+
+// Kernels return a mask with bit w set if tagP[w] == tag, for up to 64 ways.
+// Validity is applied by the caller
+unsigned long long cacheMatchScalar( addrT* tagP, int numWays, addrT tag )
+{
+   unsigned long long mask = 0;
+   for( int way = 0; way < numWays; way++ )
+      mask |= (unsigned long long) ( tagP[way] == tag ) << way;
+   return mask;
+}
+
+#if defined(CACHE_X86) && defined(DS_64)
+// 2 ways per compare
+__attribute__((target("sse4.1")))
+unsigned long long cacheMatchSSE41( addrT* tagP, int numWays, addrT tag )
+{
+   __m128i key             = _mm_set1_epi64x( tag );
+   unsigned long long mask = 0;
+   int way                 = 0;
+   for( ; way + 2 <= numWays; way += 2 ){
+      __m128i eq           = _mm_cmpeq_epi64( _mm_loadu_si128( (__m128i*) ( tagP + way ) ), key );
+      mask                |= (unsigned long long) _mm_movemask_pd( _mm_castsi128_pd( eq ) ) << way;
+   }
+   // No tail left, way may be 64 which is too far to shift
+   if( way == numWays ) return mask;
+   return mask | ( cacheMatchScalar( tagP + way, numWays - way, tag ) << way );
+}
+
+// 4 ways per compare
+__attribute__((target("avx2")))
+unsigned long long cacheMatchAVX2( addrT* tagP, int numWays, addrT tag )
+{
+   __m256i key             = _mm256_set1_epi64x( tag );
+   unsigned long long mask = 0;
+   int way                 = 0;
+   for( ; way + 4 <= numWays; way += 4 ){
+      __m256i eq           = _mm256_cmpeq_epi64( _mm256_loadu_si256( (__m256i*) ( tagP + way ) ), key );
+      mask                |= (unsigned long long) _mm256_movemask_pd( _mm256_castsi256_pd( eq ) ) << way;
+   }
+   // No tail left, way may be 64 which is too far to shift
+   if( way == numWays ) return mask;
+   return mask | ( cacheMatchScalar( tagP + way, numWays - way, tag ) << way );
+}
+#elif defined(CACHE_X86)
+// 4 ways per compare
+__attribute__((target("sse2")))
+unsigned long long cacheMatchSSE2( addrT* tagP, int numWays, addrT tag )
+{
+   __m128i key             = _mm_set1_epi32( tag );
+   unsigned long long mask = 0;
+   int way                 = 0;
+   for( ; way + 4 <= numWays; way += 4 ){
+      __m128i eq           = _mm_cmpeq_epi32( _mm_loadu_si128( (__m128i*) ( tagP + way ) ), key );
+      mask                |= (unsigned long long) _mm_movemask_ps( _mm_castsi128_ps( eq ) ) << way;
+   }
+   // No tail left, way may be 64 which is too far to shift
+   if( way == numWays ) return mask;
+   return mask | ( cacheMatchScalar( tagP + way, numWays - way, tag ) << way );
+}
+
+// 8 ways per compare
+__attribute__((target("avx2")))
+unsigned long long cacheMatchAVX2( addrT* tagP, int numWays, addrT tag )
+{
+   __m256i key             = _mm256_set1_epi32( tag );
+   unsigned long long mask = 0;
+   int way                 = 0;
+   for( ; way + 8 <= numWays; way += 8 ){
+      __m256i eq           = _mm256_cmpeq_epi32( _mm256_loadu_si256( (__m256i*) ( tagP + way ) ), key );
+      mask                |= (unsigned long long) _mm256_movemask_ps( _mm256_castsi256_ps( eq ) ) << way;
+   }
+   // No tail left, way may be 64 which is too far to shift
+   if( way == numWays ) return mask;
+   return mask | ( cacheMatchScalar( tagP + way, numWays - way, tag ) << way );
+}
+#else
+#ifdef DS_64
+unsigned long long cacheMatchSSE41( addrT* tagP, int numWays, addrT tag ) { return cacheMatchScalar( tagP, numWays, tag ); }
+#else
+unsigned long long cacheMatchSSE2( addrT* tagP, int numWays, addrT tag ) { return cacheMatchScalar( tagP, numWays, tag ); }
+#endif
+unsigned long long cacheMatchAVX2( addrT* tagP, int numWays, addrT tag ) { return cacheMatchScalar( tagP, numWays, tag ); }
+#endif
+
+// Picks the widest kernel the CPU runs. Below 4 ways there is nothing to
+// vectorize, and below 8 AVX2 would only ever take the scalar tail.
+// 64 bit tags fit half as many ways in a vector
+void cacheSelectMatch( cachePT cacheP )
+{
+   cacheP->matchFP         = cacheMatchScalar;
+   cacheP->matchName       = "scalar";
+#if defined(CACHE_X86) && defined(DS_64)
+   __builtin_cpu_init();
+   if( cacheP->assoc >= 4 && __builtin_cpu_supports( "avx2" ) ){
+      cacheP->matchFP      = cacheMatchAVX2;
+      cacheP->matchName    = "avx2";
+   } else if( cacheP->assoc >= 2 && __builtin_cpu_supports( "sse4.1" ) ){
+      cacheP->matchFP      = cacheMatchSSE41;
+      cacheP->matchName    = "sse4.1";
+   }
+#elif defined(CACHE_X86)
+   __builtin_cpu_init();
+   if( cacheP->assoc >= 8 && __builtin_cpu_supports( "avx2" ) ){
+      cacheP->matchFP      = cacheMatchAVX2;
+      cacheP->matchName    = "avx2";
+   } else if( cacheP->assoc >= 4 && __builtin_cpu_supports( "sse2" ) ){
+      cacheP->matchFP      = cacheMatchSSE2;
+      cacheP->matchName    = "sse2";
+   }
+#endif
+}
+
+// Way holding a valid copy of tag, assoc if none.
+// Works on 64 ways at a time, the lowest matching way wins
+int cacheFindWay( cachePT cacheP, int index, addrT tag )
+{
+   addrT* tagP                           = cacheP->tagP + CACHE_SLOT( cacheP, index, 0 );
+   unsigned long long* validP          = cacheP->validP + CACHE_WORD( cacheP, index, 0 );
+   for( int word = 0; word < cacheP->maskWords; word++ ){
+      int base                         = word * 64;
+      int numWays                      = ( cacheP->assoc - base < 64 ) ? cacheP->assoc - base : 64;
+      unsigned long long hits          = cacheP->matchFP( tagP + base, numWays, tag ) & validP[word];
+      if( hits ) return base + __builtin_ctzll( hits );
+   }
+   return cacheP->assoc;
+}
+
+// Lowest invalid way, assoc if the set is full.
+// Bits above assoc in the last word are never set, mask them off
+int cacheFindFreeWay( cachePT cacheP, int index )
+{
+   unsigned long long* validP          = cacheP->validP + CACHE_WORD( cacheP, index, 0 );
+   for( int word = 0; word < cacheP->maskWords; word++ ){
+      int base                         = word * 64;
+      unsigned long long free          = ~validP[word];
+      if( cacheP->assoc - base < 64 )
+         free                         &= ( 1ULL << ( cacheP->assoc - base ) ) - 1;
+      if( free ) return base + __builtin_ctzll( free );
+   }
+   return cacheP->assoc;
+}
+
+//-------------- TAG MATCH END   ---------------
+
 // This will do a cache connection
 // Cache A -> Cache B
 // Thus, cache A is more close to processor
@@ -134,12 +416,13 @@ void cacheAttachVictimCache( cachePT cacheP, int size, int blockSize, cacheTimin
 // Its the input of cache
 // address: input address of cache
 // dir    : read/write
-cacheCommT cacheCommunicate( cachePT cacheP, int address, cmdDirT dir )
+cacheCommT cacheCommunicate( cachePT cacheP, addrT address, cmdDirT dir )
 {
    if( cacheP == NULL ) return (cacheCommT){FALSE, 0, 0};
 
    // For safety, init with 0s
-   int tag=0, index=0, offset=0, setIndex=0;
+   addrT tag=0;
+   int index=0, offset=0, setIndex=0;
    cacheCommT comm;
    boolean hit;
    cacheDecodeAddress(cacheP, address, &tag, &index, &offset);
@@ -168,7 +451,7 @@ cacheCommT cacheCommunicate( cachePT cacheP, int address, cmdDirT dir )
 //    --------------------------------------------
 //   |    Tag      |     Index   |  Block Offset  |
 //    --------------------------------------------
-void cacheDecodeAddress( cachePT cacheP, int address, int* tagP, int* indexP, int* offsetP )
+void cacheDecodeAddress( cachePT cacheP, addrT address, addrT* tagP, int* indexP, int* offsetP )
 {
    //TODO: Optimize this code for speedup by storing interm result. Will it speedup?
    // Do the sanity masking
@@ -185,7 +468,7 @@ void cacheDecodeAddress( cachePT cacheP, int address, int* tagP, int* indexP, in
 //    --------------------------------------------
 //   |    Tag      |     Index   |  Block Offset  |
 //    --------------------------------------------
-int cacheEncodeAddress( cachePT cacheP, int tag, int index, int offset )
+addrT cacheEncodeAddress( cachePT cacheP, addrT tag, int index, int offset )
 {
    return ( cacheP->tagMask  & tag     ) << (cacheP->boSize + cacheP->indexSize) |
           ( cacheP->indexMask & index  ) << (cacheP->boSize) |
@@ -195,7 +478,7 @@ int cacheEncodeAddress( cachePT cacheP, int tag, int index, int offset )
 // Utility function to help doRead and doWrite
 // hit =  0 => miss
 // hit =  1 => hit
-boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP, cmdDirT dir, int allocate )
+boolean cacheDoReadWriteCommon( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP, cmdDirT dir, int allocate )
 {
    // Assume capacity miss for default case
    boolean hit               = FALSE;
@@ -204,16 +487,12 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
    ASSERT(cacheP->nSets <= index, "index translated to more than available! index: %d, nSets: %d", 
           index, cacheP->nSets);
 
-   tagPT* rowP     = cacheP->tagStoreP[index]->rowP;
+   addrT* tagP     = cacheP->tagP + CACHE_SLOT( cacheP, index, 0 );
 
    // Check if its a hit or a miss by looking in each set
-   for( setIndex = 0; setIndex < cacheP->assoc ; setIndex++ ){
-      // Check tag IFF data is valid
-      if( rowP[setIndex]->valid == 1 && rowP[setIndex]->tag == tag ){
-         hit       = TRUE;
-         break;
-      }
-   }
+   // Check tag IFF data is valid
+   setIndex        = cacheFindWay( cacheP, index, tag );
+   hit             = ( setIndex < cacheP->assoc ) ? TRUE : FALSE;
 
    *setIndexP = setIndex;
    // For read in Victim Cache, end right here!
@@ -227,6 +506,8 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
          cacheHitUpdateLRU( cacheP, index, setIndex );
       } else if( cacheP->repPolicy == POLICY_REP_LFU ){
          cacheHitUpdateLFU( cacheP, index, setIndex );
+      } else if( cacheP->repPolicy == POLICY_REP_PLRU ){
+         cacheHitUpdatePLRU( cacheP, index, setIndex );
       } else{
          cacheHitUpdateLRFU( cacheP, index, setIndex );
       }
@@ -239,19 +520,16 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
       if( ( dir == CMD_DIR_WRITE && allocate ) || dir == CMD_DIR_READ ){
          // Irrespective of replacement policy, check if there exists
          // a block with valid bit unset
-         int success   = 0;
-         for( setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-            if( rowP[setIndex]->valid == 0 ){
-               success = 1;
-               break;
-            }
-         }
+         setIndex      = cacheFindFreeWay( cacheP, index );
+         int success   = ( setIndex < cacheP->assoc ) ? 1 : 0;
 
          // If we don't have success, use the replacement policy
          if( cacheP->repPolicy == POLICY_REP_LRU ){
             setIndex           = cacheFindReplacementUpdateCounterLRU( cacheP, index, tag, setIndex, success );
          } else if( cacheP->repPolicy == POLICY_REP_LFU ){
             setIndex           = cacheFindReplacementUpdateCounterLFU( cacheP, index, tag, setIndex, success );
+         } else if( cacheP->repPolicy == POLICY_REP_PLRU ){
+            setIndex           = cacheFindReplacementUpdateCounterPLRU( cacheP, index, tag, setIndex, success );
          } else{
             setIndex           = cacheFindReplacementUpdateCounterLRFU( cacheP, index, tag, setIndex, success );
          }
@@ -275,17 +553,13 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
             } else{
                // Write the evicted data to victim cache and continue fetching
                // new data for current block
-               if( rowP[setIndex]->valid ){
+               if( cacheIsValid( cacheP, index, setIndex ) ){
                   cacheCommT victimComm               = cacheCommunicate( cacheP->victimP, 
-                                                           cacheEncodeAddress( cacheP, rowP[setIndex]->tag, index, 0 ), 
+                                                           cacheEncodeAddress( cacheP, tagP[setIndex], index, 0 ), 
                                                            CMD_DIR_WRITE );
                   // Exclusively update the dirty bit to make data consistent
-                  // TODO: Create a wrapper function to stop direct access
-                  //       to internal structures. For now it will work
-                  cacheP->victimP
-                        ->tagStoreP[victimComm.index]
-                        ->rowP[victimComm.setIndex]
-                        ->dirty                       = rowP[setIndex]->dirty;
+                  cacheSetDirty( cacheP->victimP, victimComm.index, victimComm.setIndex,
+                                 cacheIsDirty( cacheP, index, setIndex ) );
                   bypassWriteback                     = TRUE;
                }
             }
@@ -293,10 +567,10 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
          //-------------- VICTIM CACHE SPECIFIC CODE END -----------------------------------
 
          // Is the data we are updating dirty?
-         if( rowP[setIndex]->valid && !bypassWriteback ){
-            if( rowP[setIndex]->dirty ){
+         if( cacheIsValid( cacheP, index, setIndex ) && !bypassWriteback ){
+            if( cacheIsDirty( cacheP, index, setIndex ) ){
                // Construct the address and write it back
-               cacheWriteBackData( cacheP, cacheEncodeAddress( cacheP, rowP[setIndex]->tag, index, 0 ) );
+               cacheWriteBackData( cacheP, cacheEncodeAddress( cacheP, tagP[setIndex], index, 0 ) );
             }
          }
 
@@ -309,9 +583,9 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
          // Update tag value and make bit non-dirty
          // CAUTION: setting dirty will be handled in
          // doWrite
-         rowP[setIndex]->tag   = tag;
-         rowP[setIndex]->valid = 1;
-         rowP[setIndex]->dirty = 0;
+         tagP[setIndex]        = tag;
+         cacheSetValid( cacheP, index, setIndex, TRUE );
+         cacheSetDirty( cacheP, index, setIndex, FALSE );
       }
 
       // Since its a miss, refil the value from higer level cache/memory if 
@@ -329,26 +603,28 @@ boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index,
 // Module to swap contents of victim cache
 void cacheVictimSwap( cachePT cacheP, int index, int setIndex, int victimIndex, int victimSetIndex )
 {
-   tagPT   victimTagP   = cacheP->victimP->tagStoreP[victimIndex]->rowP[victimSetIndex];
-   tagPT   cacheTagP    = cacheP->tagStoreP[index]->rowP[setIndex];
+   cachePT victimP      = cacheP->victimP;
+   addrT*  victimTagP   = &victimP->tagP[ CACHE_SLOT( victimP, victimIndex, victimSetIndex ) ];
+   addrT*  cacheTagP    = &cacheP->tagP[ CACHE_SLOT( cacheP, index, setIndex ) ];
 
    // Encode
-   int cacheAddress     = cacheEncodeAddress( cacheP, cacheTagP->tag, index, 0 );
-   int victimAddress    = cacheEncodeAddress( cacheP->victimP, victimTagP->tag, victimIndex, 0 );
+   addrT cacheAddress   = cacheEncodeAddress( cacheP, *cacheTagP, index, 0 );
+   addrT victimAddress  = cacheEncodeAddress( victimP, *victimTagP, victimIndex, 0 );
 
-   // Decode
-   int newCacheTag, newVictimTag, offset;
-   cacheDecodeAddress(cacheP, victimAddress, &newCacheTag, &index, &offset);
-   cacheDecodeAddress(cacheP->victimP, cacheAddress, &newVictimTag, &index, &offset);
-   
    // Swap the dirty bits
-   int victimDirty      = victimTagP->dirty;
-   victimTagP->dirty    = cacheTagP->dirty;
-   cacheTagP->dirty     = victimDirty;
+   boolean victimDirty  = cacheIsDirty( victimP, victimIndex, victimSetIndex );
+   cacheSetDirty( victimP, victimIndex, victimSetIndex, cacheIsDirty( cacheP, index, setIndex ) );
+   cacheSetDirty( cacheP, index, setIndex, victimDirty );
+
+   // Decode
+   addrT newCacheTag, newVictimTag;
+   int offset, newIndex;
+   cacheDecodeAddress(cacheP, victimAddress, &newCacheTag, &newIndex, &offset);
+   cacheDecodeAddress(victimP, cacheAddress, &newVictimTag, &newIndex, &offset);
 
    // Swap the computed tags
-   victimTagP->tag      = newVictimTag;
-   cacheTagP->tag       = newCacheTag;
+   *victimTagP          = newVictimTag;
+   *cacheTagP           = newCacheTag;
 
    // Update counters as if a hit
    // TODO: Fix this if victim supports anything more than LRU
@@ -359,14 +635,14 @@ void cacheVictimSwap( cachePT cacheP, int index, int setIndex, int victimIndex,
    cacheP->victimP->swaps++;
 }
 
-boolean cacheDoRead( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP )
+boolean cacheDoRead( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP )
 {
    return cacheDoReadWriteCommon( cacheP, address, tag, index, offset, setIndexP, CMD_DIR_READ, 1 );
 }
 
 // hit =  0 => miss
 // hit =  1 => hit
-boolean cacheDoWrite( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP )
+boolean cacheDoWrite( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP )
 {
    boolean hit;
    if( cacheP->writePolicy == POLICY_WRITE_BACK_WRITE_ALLOCATE ){
@@ -374,7 +650,7 @@ boolean cacheDoWrite( cachePT cacheP, int address, int tag, int index, int offse
       // Irrespective of everything, set the dirty bit
       // If it was a miss, common utility will take care of the replacement and will update the
       // tag accordingly
-      cacheP->tagStoreP[index]->rowP[*setIndexP]->dirty = 1;
+      cacheSetDirty( cacheP, index, *setIndexP, TRUE );
    } else{
       // No block gets dirty in write through
       hit           = cacheDoReadWriteCommon( cacheP, address, tag, index, offset, setIndexP, CMD_DIR_WRITE, 0 );
@@ -382,7 +658,7 @@ boolean cacheDoWrite( cachePT cacheP, int address, int tag, int index, int offse
    return hit;
 }
 
-void cacheWriteBackData( cachePT cacheP, int address )
+void cacheWriteBackData( cachePT cacheP, addrT address )
 {
    cacheP->writeBackCount++;
    // Pass on to next level cache/memory
@@ -392,35 +668,19 @@ void cacheWriteBackData( cachePT cacheP, int address )
 // LRU replacement policy engine
 // For LRU, we dont need overrideSetIndex or doOverride as the minimum value will always 
 // point to the invalid date. Keeping the signature for inter-operatibility
-int cacheFindReplacementUpdateCounterLRU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride )
+int cacheFindReplacementUpdateCounterLRU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride )
 {
-   tagPT   *rowP = cacheP->tagStoreP[index]->rowP;
-   int replIndex = 0;
-
-   // Place data at max counter value and reset counter to 0
-   // Increment all counters
-   if( doOverride ){
-      // Update the counter values just as if it was a hit for this index
-      cacheHitUpdateLRU( cacheP, index, overrideSetIndex );
-      replIndex  = overrideSetIndex;
-
-   } else{
-      // Speedup: do a increment % assoc to all elements and update tag
-      // for value 0
-      for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-         rowP[setIndex]->counter   = (rowP[setIndex]->counter + 1) % cacheP->assoc;
-         if( rowP[setIndex]->counter == 0 )
-            replIndex              = setIndex;
-      }
-   }
-
+   // Evict the tail of the recency list and make it MRU, same as the
+   // block whose counter used to wrap to 0
+   int replIndex = ( doOverride ) ? overrideSetIndex : cacheP->lruTailP[index];
+   cacheHitUpdateLRU( cacheP, index, replIndex );
    return replIndex;
 }
 
 // Least frequently used with dynamic aging
-int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride )
+int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride )
 {
-   tagPT   *rowP = cacheP->tagStoreP[index]->rowP;
+   countT  *counterP = cacheP->counterP + CACHE_SLOT( cacheP, index, 0 );
    
    int replIndex = 0;
 
@@ -430,12 +690,12 @@ int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, int tag, in
    } else{
       // Search for block having lowest counter value to evicit
       // Init the minValue tracker to first counter value
-      int minValue    = rowP[0]->counter;
+      countT minValue = counterP[0];
 
       // Start from 1 instead
       for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-         if( rowP[setIndex]->counter < minValue ){
-            minValue  = rowP[setIndex]->counter;
+         if( counterP[setIndex] < minValue ){
+            minValue  = counterP[setIndex];
             replIndex = setIndex;
          }
       }
@@ -444,84 +704,145 @@ int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, int tag, in
    //TODO: there is no need for a countSet
    // By now we know which block has to be evicted
    // Set the age counter before evicting
-   cacheP->tagStoreP[index]->countSet     = rowP[replIndex]->counter;
+   cacheP->countSetP[index]               = counterP[replIndex];
 
    // Update the counter value for the newly placed entry
    // Since its the job of this function to update all counter
-   rowP[replIndex]->counter               = cacheP->tagStoreP[index]->countSet + 1;
+   counterP[replIndex]                    = cacheP->countSetP[index] + 1;
 
    return replIndex;
 }
 
-inline double cacheCRF_F( cachePT cacheP, tagPT *rowP, int setIndex )
+// 0.5^(lambda * dt) as a product of one table entry per digit of dt.
+// Each entry is a correctly rounded pow, so the product is within a few
+// ulp of the single pow. The exponent lambda * dt itself rounds
+// differently though, which costs up to lambda * dt * ln2 ulp. Over the
+// range that does not underflow (lambda * dt < 1075) the two agree to
+// a relative 1e-12, and exactly for lambda 0 and 1
+inline double cacheDecay( cachePT cacheP, countT dt )
 {
-   return rowP[setIndex]->crf * (pow(0.5, cacheP->lambda * ( cacheP->numAccess - rowP[setIndex]->counter )));
+   ucountT        udt       = (ucountT) dt;
+   double*        decayP    = cacheP->decayP;
+   double         decay     = decayP[ udt & CACHE_DECAY_MASK ];
+   for( int level = 1; level < CACHE_DECAY_LEVELS; level++ )
+      decay                *= decayP[ level * CACHE_DECAY_SIZE + ( ( udt >> ( level * CACHE_DECAY_BITS ) ) & CACHE_DECAY_MASK ) ];
+   return decay;
+}
+
+inline double cacheCRF_F( cachePT cacheP, int slot )
+{
+   return cacheP->crfP[slot] * cacheDecay( cacheP, cacheP->numAccess - cacheP->counterP[slot] );
 }
 
 // Least Recently/Frequently used
-int cacheFindReplacementUpdateCounterLRFU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride )
+int cacheFindReplacementUpdateCounterLRFU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride )
 {
 
-   tagPT   *rowP   = cacheP->tagStoreP[index]->rowP;
+   int slot0       = CACHE_SLOT( cacheP, index, 0 );
    int replIndex   = 0;
 
    if( doOverride ){
       replIndex = overrideSetIndex;
    } else{
-      double *tempCrf = (double*) calloc(cacheP->assoc, sizeof(double));
-
-      // Computer temporary CRF
-      for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-         tempCrf[setIndex] = cacheCRF_F( cacheP, rowP, setIndex );
-      }
-      
-      double minCrf = tempCrf[0];
-
-      // Find the block
-      for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
-         if( tempCrf[setIndex] < minCrf ){
+      // Single pass, first minimum wins ties
+      double minCrf = cacheCRF_F( cacheP, slot0 );
+      for( int setIndex = 1; setIndex < cacheP->assoc; setIndex++ ){
+         double crf = cacheCRF_F( cacheP, slot0 + setIndex );
+         if( crf < minCrf ){
             replIndex = setIndex;
-            minCrf    = tempCrf[setIndex];
+            minCrf    = crf;
          }
       }
-
-      // Free the allocated memory
-      free( tempCrf );
    }
 
    // Update the vals
-   rowP[replIndex]->crf     = 1;
-   rowP[replIndex]->counter = cacheP->numAccess;
+   cacheP->crfP[ slot0 + replIndex ]     = 1;
+   cacheP->counterP[ slot0 + replIndex ] = cacheP->numAccess;
 
    return replIndex;
 }
 
-void cacheHitUpdateLRU( cachePT cacheP, int index, int setIndex )
+// Recency list starts out as way 0 MRU .. way assoc-1 LRU, the order
+// the old per way LRU counters started in
+void cacheInitSetLRU( cachePT cacheP, int index )
 {
-   tagPT     *rowP = cacheP->tagStoreP[index]->rowP;
-
-   // Increment the counter of other blocks whose counters are less
-   // than the referenced block's old counter value
-   for( int assocIndex = 0; assocIndex < cacheP->assoc; assocIndex++ ){
-      if( rowP[assocIndex]->counter < rowP[setIndex]->counter )
-         rowP[assocIndex]->counter++;
+   unsigned short* nextP    = cacheP->lruNextP + CACHE_SLOT( cacheP, index, 0 );
+   unsigned short* prevP    = cacheP->lruPrevP + CACHE_SLOT( cacheP, index, 0 );
+   for( int setIndex = 0; setIndex < cacheP->assoc; setIndex++ ){
+      nextP[setIndex]       = setIndex + 1;
+      prevP[setIndex]       = setIndex - 1;
    }
+   cacheP->lruHeadP[index]  = 0;
+   cacheP->lruTailP[index]  = cacheP->assoc - 1;
+   cacheP->lruTouchedP[ index >> 6 ] |= CACHE_BIT( index );
+}
 
-   // Set the referenced block's counter to 0 (Most recently used)
-   rowP[setIndex]->counter = 0;
+void cacheHitUpdateLRU( cachePT cacheP, int index, int setIndex )
+{
+   // Every set's first access comes through here: an empty set fills a
+   // free way, which is handled as a hit on that way
+   if( !( cacheP->lruTouchedP[ index >> 6 ] & CACHE_BIT( index ) ) )
+      cacheInitSetLRU( cacheP, index );
+
+   // Move the referenced block to the head (Most recently used).
+   // Everything that was more recent moves down by one, no other block
+   // changes order
+   int head                 = cacheP->lruHeadP[index];
+   if( head == setIndex ) return;
+
+   unsigned short* nextP    = cacheP->lruNextP + CACHE_SLOT( cacheP, index, 0 );
+   unsigned short* prevP    = cacheP->lruPrevP + CACHE_SLOT( cacheP, index, 0 );
+   int prev                 = prevP[setIndex];
+   nextP[prev]              = nextP[setIndex];
+   if( cacheP->lruTailP[index] == setIndex )
+      cacheP->lruTailP[index] = prev;
+   else
+      prevP[ nextP[setIndex] ] = prev;
+
+   nextP[setIndex]          = head;
+   prevP[head]              = setIndex;
+   cacheP->lruHeadP[index]  = setIndex;
 }
 
 void cacheHitUpdateLFU( cachePT cacheP, int index, int setIndex )
 {
    // Increment the counter value of the set which is indexed
-   cacheP->tagStoreP[index]->rowP[setIndex]->counter++;
+   cacheP->counterP[ CACHE_SLOT( cacheP, index, setIndex ) ]++;
 }
 
 void cacheHitUpdateLRFU( cachePT cacheP, int index, int setIndex )
 {
-   tagPT *rowP             = cacheP->tagStoreP[index]->rowP;
-   rowP[setIndex]->crf     = 1 + cacheCRF_F( cacheP, rowP, setIndex );
-   rowP[setIndex]->counter = cacheP->numAccess;
+   int slot                = CACHE_SLOT( cacheP, index, setIndex );
+   cacheP->crfP[slot]      = 1 + cacheCRF_F( cacheP, slot );
+   cacheP->counterP[slot]  = cacheP->numAccess;
+}
+
+// Tree pseudo LRU. Walk root to leaf following the bits to find the
+// victim, and on every reference flip the bits on the path to point away
+int cacheFindReplacementUpdateCounterPLRU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride )
+{
+   int replIndex = overrideSetIndex;
+   if( !doOverride ){
+      unsigned long long* bitsP   = cacheP->plruP + CACHE_WORD( cacheP, index, 0 );
+      int node                    = 1;
+      while( node < cacheP->assoc )
+         node                     = 2 * node + ( ( bitsP[ node >> 6 ] >> ( node & 63 ) ) & 1 );
+      replIndex                   = node - cacheP->assoc;
+   }
+   cacheHitUpdatePLRU( cacheP, index, replIndex );
+   return replIndex;
+}
+
+void cacheHitUpdatePLRU( cachePT cacheP, int index, int setIndex )
+{
+   unsigned long long* bitsP      = cacheP->plruP + CACHE_WORD( cacheP, index, 0 );
+   // Leaf of the way, then walk up. Each parent points at the sibling
+   for( int node = cacheP->assoc + setIndex; node > 1; node >>= 1 ){
+      int parent                  = node >> 1;
+      unsigned long long bit      = 1ULL << ( parent & 63 );
+      unsigned long long set      = 0ULL - (unsigned long long) ( ~node & 1 );
+      bitsP[ parent >> 6 ]        = ( bitsP[ parent >> 6 ] & ~bit ) | ( set & bit );
+   }
 }
 
 char* cacheGetNameReplacementPolicyT(replacementPolicyT policy)
@@ -530,6 +851,7 @@ char* cacheGetNameReplacementPolicyT(replacementPolicyT policy)
       case POLICY_REP_LRU                         : return "LRU";
       case POLICY_REP_LFU                         : return "LFU";
       case POLICY_REP_LRFU                        : return "LRFU";
+      case POLICY_REP_PLRU                        : return "PLRU";
       default                                     : return "";
    }
 }
@@ -557,33 +879,33 @@ void cachePrintContents( cachePT cacheP )
 {
    if( !cacheP ) return;
    printf("%s CACHE CONTENTS\n", cacheP->name);
-   printf("a. number of accesses :%d\n", cacheP->readHitCount + cacheP->readMissCount + cacheP->writeHitCount + cacheP->writeMissCount);
-   printf("b. number of misses :%d\n", cacheP->readMissCount + cacheP->writeMissCount);
+   printf("a. number of accesses :%" PRIcount "\n", cacheP->readHitCount + cacheP->readMissCount + cacheP->writeHitCount + cacheP->writeMissCount);
+   printf("b. number of misses :%" PRIcount "\n", cacheP->readMissCount + cacheP->writeMissCount);
    for( int setIndex = 0; setIndex < cacheP->nSets; setIndex++ ){
       printf("set %d :", setIndex);
-      tagPT *rowP = cacheP->tagStoreP[setIndex]->rowP;
+      addrT *tagP = cacheP->tagP + CACHE_SLOT( cacheP, setIndex, 0 );
       for( int assocIndex = 0; assocIndex < cacheP->assoc; assocIndex++ ){
-         printf("%x %c\t", rowP[assocIndex]->tag, (rowP[assocIndex]->dirty) ? 'D' : ' ' );
+         printf("%" PRIaddr " %c\t", tagP[assocIndex], cacheIsDirty( cacheP, setIndex, assocIndex ) ? 'D' : ' ' );
       }
       printf("\n");
    }
    printf("\n");
 }
 
-inline int cacheGetWBCount( cachePT cacheP )
+inline countT cacheGetWBCount( cachePT cacheP )
 {
    return (cacheP) ? cacheP->writeBackCount : 0;
 }
 
 void cacheGetStats( cachePT cacheP, 
-                    int     *readCount, 
-                    int     *readMisses, 
-                    int     *writeCount, 
-                    int     *writeMisses, 
+                    countT  *readCount, 
+                    countT  *readMisses, 
+                    countT  *writeCount, 
+                    countT  *writeMisses, 
                     double  *missRate, 
-                    int     *swaps, 
-                    int     *writeBacks, 
-                    int     *memoryTraffic )
+                    countT  *swaps, 
+                    countT  *writeBacks, 
+                    countT  *memoryTraffic )
 {
    if( !cacheP ) return;
    *readMisses    = cacheP->readMissCount;
@@ -595,7 +917,7 @@ void cacheGetStats( cachePT cacheP,
                          *readMisses + *writeMisses + cacheP->writeBackCount :
                          *readMisses + *writeCount;
    if( cacheP->victimP != NULL ){
-      int vRreads, vReadMisses, vWrites, vWriteMisses, vSwaps, vWB, vMemoryTraffic;
+      countT vRreads, vReadMisses, vWrites, vWriteMisses, vSwaps, vWB, vMemoryTraffic;
       double vMissRate;
       cacheGetStats( cacheP->victimP, &vRreads, &vReadMisses, &vWrites, &vWriteMisses, &vMissRate, &vSwaps, &vWB, &vMemoryTraffic ); 
       *memoryTraffic += vWB;
@@ -16,16 +16,24 @@
 
 #include "all.h"
 
-// Mask for 32 bit address
+// Mask for the address width of the build
+#ifdef DS_64
+#define   ADDRESS_MASK     0xFFFFFFFFFFFFFFFFULL
+#else
 #define   ADDRESS_MASK     0xFFFFFFFF
-#define   ADDRESS_SIZE     32
+#endif
+#define   ADDRESS_SIZE     ADDR_BITS
+
+// LRFU decay table layout, levels of 11 bits cover every countT dt
+#define   CACHE_DECAY_BITS     11
+#define   CACHE_DECAY_LEVELS   ( ( ADDR_BITS + CACHE_DECAY_BITS - 1 ) / CACHE_DECAY_BITS )
+#define   CACHE_DECAY_SIZE     ( 1 << CACHE_DECAY_BITS )
+#define   CACHE_DECAY_MASK     ( CACHE_DECAY_SIZE - 1 )
 
 // Pointer translations
 typedef  struct  _cmdDirT             *cmdDirPT;
 typedef  struct  _replacementPolicyT  *replacementPolicyPT;
 typedef  struct  _writePolicyT        *writePolicyPT;
-typedef  struct  _tagT                *tagPT;
-typedef  struct  _tagStoreT           *tagStorePT;
 typedef  struct  _cacheT              *cachePT;
 typedef  struct  _cacheTimingTrayT    *cacheTimingTrayPT;
 
@@ -40,6 +48,7 @@ typedef enum {
    POLICY_REP_LRU                           = 0,      /* Least Recently Used */
    POLICY_REP_LFU                           = 1,      /* Least Frequently Used */
    POLICY_REP_LRFU                          = 2,      /* Least Recently/Frequently Used */
+   POLICY_REP_PLRU                          = 3,      /* Tree pseudo LRU, power of 2 assoc */
 }replacementPolicyT;
 
 // Enum to hold write policies
@@ -48,26 +57,6 @@ typedef enum {
    POLICY_WRITE_THROUGH_WRITE_NOT_ALLOCATE  = 1,
 }writePolicyT;
 
-typedef struct _tagT{
-   int               tag;
-   boolean           valid;
-   boolean           dirty;
-   
-   // Common counter for LRU and LFU
-   // We will use this counter as LAST_REF_TIMESTAMP for LRFU
-   int               counter;
-
-   // Only for LRFU
-   double            crf;
-}tagT;
-
-// Tag store unit cell
-typedef struct _tagStoreT{
-   tagPT             *rowP;
-   // COUNT_SET value for LFU
-   int               countSet;
-}tagStoreT;
-
 // Cache communication struct
 typedef struct _cacheCommT{
    boolean            hit;
@@ -109,26 +98,58 @@ typedef struct _cacheT{
    /*
     * Internal variables
     */
-   int                  tagMask;
-   int                  indexMask;
-   int                  boMask;
+   addrT                tagMask;
+   addrT                indexMask;
+   addrT                boMask;
 
-   int                  readHitCount;
-   int                  readMissCount;
+   countT               readHitCount;
+   countT               readMissCount;
 
-   int                  writeHitCount;
-   int                  writeMissCount;
+   countT               writeHitCount;
+   countT               writeMissCount;
 
-   int                  writeBackCount;
-   int                  swaps;
-   int                  numAccess;
+   countT               writeBackCount;
+   countT               swaps;
+   countT               numAccess;
 
 
    // Timing params
    double               missPenalty;
    double               hitTime;
    
-   tagStorePT           *tagStoreP;
+   // Tag store, structure of arrays. Way w of set i lives in slot
+   // i * assoc + w of the per way arrays, so a set's tags are contiguous
+   // (an 8 way set is 32 bytes). valid/dirty are bitmasks of maskWords
+   // 64 bit words per set, bit w for way w
+   int                  maskWords;
+   addrT                *tagP;
+   // Counter for LFU
+   // We will use this counter as LAST_REF_TIMESTAMP for LRFU
+   countT               *counterP;
+   // Only for LRU. Per set recency list of way numbers, lruNextP/lruPrevP
+   // per way, lruHeadP (MRU) and lruTailP (LRU) per set. A set's list is
+   // built on its first access, lruTouchedP has one bit per set
+   unsigned short       *lruNextP;
+   unsigned short       *lruPrevP;
+   unsigned short       *lruHeadP;
+   unsigned short       *lruTailP;
+   unsigned long long   *lruTouchedP;
+   // Only for PLRU. assoc - 1 tree bits per set, node n at bit n, root
+   // is node 1. A bit points at the half to evict from next
+   unsigned long long   *plruP;
+   // Only for LRFU
+   double               *crfP;
+   // Only for LRFU. 0.5^(lambda * dt) by base 2^CACHE_DECAY_BITS digit
+   // of dt, CACHE_DECAY_LEVELS tables of CACHE_DECAY_SIZE entries
+   double               *decayP;
+   unsigned long long   *validP;
+   unsigned long long   *dirtyP;
+   // COUNT_SET value for LFU, per set
+   countT               *countSetP;
+
+   // Tag compare kernel picked for the host CPU by cacheInit
+   unsigned long long   (*matchFP)( addrT* tagP, int numWays, addrT tag );
+   char                 *matchName;
 
    // Following variable are only for victim cache related config
    boolean              isVictimCache;
@@ -163,20 +184,27 @@ cachePT  cacheInit(
       writePolicyT       writePolicy,
       cacheTimingTrayPT  trayP );
 
+void cacheDestroy( cachePT cacheP );
+cachePT cacheClone( cachePT cacheP );
+void cacheMergeShard( cachePT cacheP, cachePT shardP, int shard, int numShards );
 void cacheConnect( cachePT cacheAP, cachePT cacheBP );
-cacheCommT cacheCommunicate( cachePT cacheP, int address, cmdDirT dir );
-void cacheDecodeAddress( cachePT cacheP, int address, int* tag, int* index, int* offset );
-
-boolean cacheDoReadWriteCommon( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP, cmdDirT dir, int allocate );
-boolean cacheDoRead( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP);
-boolean cacheDoWrite( cachePT cacheP, int address, int tag, int index, int offset, int* setIndexP );
-void cacheWriteBackData( cachePT cacheP, int address );
-int cacheFindReplacementUpdateCounterLRU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride );
-int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride );
-int cacheFindReplacementUpdateCounterLRFU( cachePT cacheP, int index, int tag, int overrideSetIndex, int doOverride );
+cacheCommT cacheCommunicate( cachePT cacheP, addrT address, cmdDirT dir );
+void cacheDecodeAddress( cachePT cacheP, addrT address, addrT* tag, int* index, int* offset );
+
+boolean cacheDoReadWriteCommon( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP, cmdDirT dir, int allocate );
+boolean cacheDoRead( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP);
+boolean cacheDoWrite( cachePT cacheP, addrT address, addrT tag, int index, int offset, int* setIndexP );
+void cacheWriteBackData( cachePT cacheP, addrT address );
+int cacheFindReplacementUpdateCounterLRU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride );
+int cacheFindReplacementUpdateCounterLFU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride );
+double cacheDecay( cachePT cacheP, countT dt );
+int cacheFindReplacementUpdateCounterLRFU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride );
+void cacheInitSetLRU( cachePT cacheP, int index );
 void cacheHitUpdateLRU( cachePT cacheP, int index, int setIndex );
 void cacheHitUpdateLFU( cachePT cacheP, int index, int setIndex );
 void cacheHitUpdateLRFU( cachePT cacheP, int index, int setIndex );
+int cacheFindReplacementUpdateCounterPLRU( cachePT cacheP, int index, addrT tag, int overrideSetIndex, int doOverride );
+void cacheHitUpdatePLRU( cachePT cacheP, int index, int setIndex );
 
 
 char* cacheGetNameReplacementPolicyT(replacementPolicyT policy);
@@ -187,17 +215,31 @@ double cacheComputeMissPenalty( cachePT cacheP, cacheTimingTrayPT trayP );
 double cacheComputeHitTime( cachePT cacheP, cacheTimingTrayPT trayP );
 void cacheAttachVictimCache( cachePT cacheP, int size, int blockSize, cacheTimingTrayPT trayP );
 void cacheVictimSwap( cachePT cacheP, int index, int setIndex, int victimIndex, int victimSetIndex );
-double cacheCRF_F( cachePT cacheP, tagPT *rowP, int setIndex );
+double cacheCRF_F( cachePT cacheP, int slot );
+int cacheFindWay( cachePT cacheP, int index, addrT tag );
+int cacheFindFreeWay( cachePT cacheP, int index );
+void cacheSelectMatch( cachePT cacheP );
+unsigned long long cacheMatchScalar( addrT* tagP, int numWays, addrT tag );
+#ifdef DS_64
+unsigned long long cacheMatchSSE41( addrT* tagP, int numWays, addrT tag );
+#else
+unsigned long long cacheMatchSSE2( addrT* tagP, int numWays, addrT tag );
+#endif
+unsigned long long cacheMatchAVX2( addrT* tagP, int numWays, addrT tag );
+boolean cacheIsValid( cachePT cacheP, int index, int setIndex );
+boolean cacheIsDirty( cachePT cacheP, int index, int setIndex );
+void cacheSetValid( cachePT cacheP, int index, int setIndex, boolean valid );
+void cacheSetDirty( cachePT cacheP, int index, int setIndex, boolean dirty );
 
 double cacheGetAAT( cachePT cacheP );
-int cacheGetWBCount( cachePT cacheP );
+countT cacheGetWBCount( cachePT cacheP );
 void cacheGetStats( cachePT cacheP, 
-                    int     *readCount, 
-                    int     *readMisses, 
-                    int     *writeCount, 
-                    int     *writeMisses, 
+                    countT  *readCount, 
+                    countT  *readMisses, 
+                    countT  *writeCount, 
+                    countT  *writeMisses, 
                     double  *missRate, 
-                    int     *swaps, 
-                    int     *writeBacks, 
-                    int     *memoryTraffic );
+                    countT  *swaps, 
+                    countT  *writeBacks, 
+                    countT  *memoryTraffic );
 #endif
@@ -10,15 +10,27 @@
 *
 *H***********************************************************************/
 
+#ifdef DS_PROFILE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "ds.h"
+#ifdef DS_PROFILE
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DS_PROF_TSC
+#endif
+#endif
 
 // Allocates and inits all internal variables
 dsPT  dynamicSchedulerInit(   
          char*              name, 
          FILE*              fp,
+         tracePT            traceP,
          int                s,
          int                n,
-         boolean            (*fetchFP)( dsPT, int*, int*, int*, int*, int*, int* ), 
+         boolean            (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* ), 
          int                blockSize,
          int                l1Size,
          int                l1Assoc,
@@ -31,22 +43,34 @@ dsPT  dynamicSchedulerInit(
 
    sprintf( dsP->name, "%s", name );
    dsP->fp                           = fp;
+   dsP->traceP                       = traceP;
    dsP->s                            = s;
    dsP->n                            = n;
    dsP->fetchFP                      = fetchFP;
+#ifdef DS_PROFILE
+   dsP->profStartTicks               = dsProfNow();
+   dsP->profStartNs                  = dsProfNs();
+#endif
+
+   // Init 2 lists, sized by configuration. The execute wheel needs no sizing
+   // FUs are pipelined: at most N issues per cycle, each in flight for
+   // at most the longest latency
+   int exSize                        = n * ( PIPE_EX_LATENCY_L2MISS + 1 );
+   dsP->dispatchList                 = fifoInit( 2 * n );
+   dsP->issueList                    = fifoInit( s );
 
-   // Init FIFO
-   dsP->fakeRobP                     = fifoInit();
+   // Init FIFO. Fake ROB is not strictly bounded (completed instructions
+   // wait for older ones), start with everything in flight and let it grow
+   dsP->fakeRobP                     = fifoInit( 2 * n + s + exSize );
 
-   // Init 3 lists
-   dsP->dispatchList                 = fifoInit();
-   dsP->issueList                    = fifoInit();
-   dsP->executeList                  = fifoInit();
+   dsP->tempQ                        = fifoInit( 2 * n );
+   dsP->selectP                      = (void**) calloc( n, sizeof(void*) );
 
-   dsP->tempQ                        = fifoInit();
+   // One slab covers the same in flight estimate as the fake ROB
+   dsP->instPoolP                    = poolInit( "INST", sizeof(dsInstInfoT), 2 * n + s + exSize );
 
    for( int i = 0; i < 128; i++ )
-      dsP->ready[i]                  = 1;
+      dsP->renameTable[i].ready      = 1;
 
    // Init cache
    cachePT  l1P          = cacheInit( "L1", l1Size, l1Assoc, blockSize, 0, POLICY_REP_LRU, POLICY_WRITE_BACK_WRITE_ALLOCATE, NULL);
@@ -57,25 +81,89 @@ dsPT  dynamicSchedulerInit(
    return dsP;
 }
 
+// Frees everything dynamicSchedulerInit allocated. Trace, trace file and
+// retire log belong to the caller
+void dsDestroy( dsPT dsP )
+{
+   fifoDestroy( dsP->dispatchList );
+   fifoDestroy( dsP->issueList );
+   fifoDestroy( dsP->fakeRobP );
+   fifoDestroy( dsP->tempQ );
+   free( dsP->selectP );
+   poolDestroy( dsP->instPoolP );
+   cacheDestroy( dsP->l1P );
+   cacheDestroy( dsP->l2P );
+   free( dsP );
+}
+
 boolean dsProcess( dsPT dsP )
 {
    boolean result;
+   dsP->active   = FALSE;
+   DS_PROF_BEGIN( dsP, DS_PROF_RETIRE );
    result     = fakeRetire( dsP );
+   DS_PROF_END( dsP, DS_PROF_RETIRE );
+   DS_PROF_BEGIN( dsP, DS_PROF_EXECUTE );
    result    &= execute( dsP );
+   DS_PROF_END( dsP, DS_PROF_EXECUTE );
+   DS_PROF_BEGIN( dsP, DS_PROF_ISSUE );
    result    &= issue( dsP );
+   DS_PROF_END( dsP, DS_PROF_ISSUE );
+   DS_PROF_BEGIN( dsP, DS_PROF_DISPATCH );
    result    &= dispatch( dsP );
+   DS_PROF_END( dsP, DS_PROF_DISPATCH );
+   DS_PROF_BEGIN( dsP, DS_PROF_FETCH );
    result    &= fetch( dsP );
+   DS_PROF_END( dsP, DS_PROF_FETCH );
    dsP->cycle++;
+
+   // Nothing moved this cycle, so every cycle until the next EX completion
+   // would do exactly the same. Jump straight there
+   if( dsP->eventDriven && !dsP->active && !result && dsP->numExecuting > 0 ){
+      countT nextEvent    = dsNextEvent( dsP );
+      dsP->skippedCycles += nextEvent - dsP->cycle;
+      dsP->cycle          = nextEvent;
+   }
    return result;
 }
 
-// If instruction is in execute, check if it has executed
-boolean dsInstInEx( dsPT dsP, dsInstInfoPT  instP )
+// Earliest cycle with a non empty wheel bucket. Everything in flight
+// finishes within DS_WHEEL_SIZE cycles, so a single lap is enough
+countT dsNextEvent( dsPT dsP )
 {
-   if( instP->stage == PROC_PIPE_STAGE_EX ){
-      return ((dsP->cycle - instP->exStart) >= instP->latency) ? TRUE : FALSE;
+   for( countT cycle = dsP->cycle; cycle < dsP->cycle + DS_WHEEL_SIZE; cycle++ ){
+      if( dsP->wheelHeadP[ cycle & DS_WHEEL_MASK ] != NULL ) return cycle;
    }
-   return FALSE;
+   ASSERT( TRUE, "Execute wheel is empty with %d instructions in flight\n", dsP->numExecuting );
+   return dsP->cycle;
+}
+
+// Files an issued instruction under the cycle it completes in.
+// execute runs before issue, so even a zero latency instruction is only
+// seen one cycle later
+void dsWheelInsert( dsPT dsP, dsInstInfoPT instP )
+{
+   instP->exFinish      = instP->exStart + ( ( instP->latency > 1 ) ? instP->latency : 1 );
+   instP->wheelNextP    = NULL;
+   int bucket           = instP->exFinish & DS_WHEEL_MASK;
+   dsInstInfoPT tailP   = dsP->wheelTailP[bucket];
+
+   if( tailP == NULL ){
+      dsP->wheelHeadP[bucket]  = instP;
+      dsP->wheelTailP[bucket]  = instP;
+   } else if( tailP->sequenceNum < instP->sequenceNum ){
+      // Common case, issued after everything already in the bucket
+      tailP->wheelNextP        = instP;
+      dsP->wheelTailP[bucket]  = instP;
+   } else{
+      // A shorter latency instruction catching up with older ones
+      dsInstInfoPT* linkPP     = &( dsP->wheelHeadP[bucket] );
+      while( (*linkPP)->sequenceNum < instP->sequenceNum )
+         linkPP                = &( (*linkPP)->wheelNextP );
+      instP->wheelNextP        = *linkPP;
+      *linkPP                  = instP;
+   }
+   dsP->numExecuting++;
 }
 
 boolean dsInstInWB( dsInstInfoPT  instP )
@@ -93,34 +181,48 @@ boolean fakeRetire( dsPT dsP )
    while( success ){
       dsInstInfoPT infoP = fifoPopTailConditional( dsP->fakeRobP, &success, dsInstInWB );
       if( success ){
-         printf("%d fu{%d} src{%d,%d} dst{%d} IF{%d,%d} ID{%d,%d} IS{%d,%d} EX{%d,%d} WB{%d,%d}\n",
-               infoP->sequenceNum, infoP->type, infoP->origSrc1, infoP->origSrc2, infoP->dst,
-               infoP->ifStart, infoP->ifDuration,
-               infoP->idStart, infoP->idDuration,
-               infoP->isStart, infoP->isDuration,
-               infoP->exStart, infoP->exDuration,
-               infoP->wbStart, infoP->wbDuration);
-         free( infoP );
+         if( dsP->rlogP ){
+            rlogRecT rec = { infoP->sequenceNum, infoP->type, infoP->origSrc1, infoP->origSrc2, infoP->dst,
+                             infoP->ifStart, infoP->ifDuration,
+                             infoP->idStart, infoP->idDuration,
+                             infoP->isStart, infoP->isDuration,
+                             infoP->exStart, infoP->exDuration,
+                             infoP->wbStart, infoP->wbDuration };
+            rlogWrite( dsP->rlogP, &rec );
+         }
+         poolFree( dsP->instPoolP, infoP );
+         dsP->active     = TRUE;
       }
    }
    return ( fifoNumElems( dsP->fakeRobP ) == 0 ) ? TRUE : FALSE;
 }
 
-void dsWakeup( int *reg,  dsInstInfoPT instP )
+// Check if instruction is ready to be scheduled
+boolean dsInstReady( dsInstInfoPT instP )
 {
-
-   if( instP->src1 == *reg ) instP->src1Ready = 1;
-   if( instP->src2 == *reg ) instP->src2Ready = 1;
+   return ( instP->src1 == -1 || instP->src1Ready == 1 ) && 
+          ( instP->src2 == -1 || instP->src2Ready == 1 );
 }
 
-
-void dsSearchDst( int *dstFlag,  dsInstInfoPT instP )
+// Wakes only the consumers registered at dispatch and flags the ones
+// that became ready in the issue list
+void dsWakeup( dsPT dsP, dsInstInfoPT instP )
 {
-   if( instP->dst == dstFlag[0] ){
-      if( instP->sequenceNum > dstFlag[1] ){
-         dstFlag[1] = instP->sequenceNum;
-      }
+   for( dsDepPT depP = instP->depHeadP; depP != NULL; depP = depP->nextP ){
+      *depP->readyP = 1;
+      if( dsInstReady( depP->consumerP ) )
+         fifoSetMark( dsP->issueList, depP->consumerP->listHandle );
    }
+   instP->depHeadP = NULL;
+}
+
+// Registers a renamed source operand on its producer
+void dsAddDependent( dsInstInfoPT producerP, dsInstInfoPT consumerP, dsDepPT depP, int* readyP )
+{
+   depP->consumerP      = consumerP;
+   depP->readyP         = readyP;
+   depP->nextP          = producerP->depHeadP;
+   producerP->depHeadP  = depP;
 }
 
 void dsExFinish( dsPT dsP, dsInstInfoPT instP )
@@ -129,17 +231,16 @@ void dsExFinish( dsPT dsP, dsInstInfoPT instP )
    instP->wbStart                 = dsP->cycle;
    instP->wbDuration              = 1;
    instP->stage                   = PROC_PIPE_STAGE_WB;
+   dsP->active                    = TRUE;
    if( instP->dst != -1 ){
-      int dstFlag[4]              = { instP->dst, 0, 0, 0 };
-
-      fifoForeach( dsP->executeList, dsSearchDst, dstFlag );
-      fifoForeach( dsP->issueList  , dsSearchDst, dstFlag );
-
-      if( !dsP->ready   [ instP->dst ] ){
-         dsP->ready   [ instP->dst ] = (dstFlag[1] == instP->sequenceNum) ? 1 : 0;
-         dsP->mapTable[ instP->dst ] = dstFlag[1];
+      // Only the youngest writer hands the register back. An older one
+      // finishing leaves the younger mapping in place
+      dsRenamePT renameP          = &( dsP->renameTable[ instP->dst ] );
+      if( !renameP->ready && renameP->tag == instP->sequenceNum ){
+         renameP->ready           = 1;
+         renameP->producerP       = NULL;
       }
-      fifoForeach( dsP->issueList, dsWakeup, &( instP->sequenceNum ) );
+      dsWakeup( dsP, instP );
    }
 }
 
@@ -152,22 +253,42 @@ boolean execute( dsPT dsP )
    // 3) Update the register file state (e.g., ready flag) and wakeup
    //    dependent instructions (set their operand ready flags)
    
-   // Remove all EX and transition in program order
-   fifoSearchOpRemoveInv( dsP->executeList, dsInstInEx, dsExFinish, dsP, FALSE );
+   // Only this cycle's bucket can finish. Transition it in program order
+   int bucket           = dsP->cycle & DS_WHEEL_MASK;
+   dsInstInfoPT instP   = dsP->wheelHeadP[bucket];
+   dsP->wheelHeadP[bucket] = NULL;
+   dsP->wheelTailP[bucket] = NULL;
+   while( instP != NULL ){
+      dsInstInfoPT nextP   = instP->wheelNextP;
+      dsExFinish( dsP, instP );
+      dsP->numExecuting--;
+      instP                = nextP;
+   }
 
-   return ( fifoNumElems( dsP->executeList ) == 0 ) ? TRUE : FALSE;
+   return ( dsP->numExecuting == 0 ) ? TRUE : FALSE;
 }
 
-void dsIssuer( dsPT dsP,  dsInstInfoPT instP )
+// One memory read through L1, then L2 on an L1 miss.
+// Returns the execution latency it costs
+int dsCacheAccess( dsPT dsP, addrT mem )
 {
-   // Check if instruction is ready to be scheduled
-   boolean ready = ( instP->src1 == -1 || instP->src1Ready == 1 ) && 
-                   ( instP->src2 == -1 || instP->src2Ready == 1 );
-   
-   if( ready ){
-      // Push to head in temp ready queue
-      fifoPush( dsP->tempQ, instP );
+   // NOTE: cacheCommunicate is smart enough to return miss if no cache is present
+   // ----------------- CACHE PLUGIN BEGIN -------------------
+   DS_PROF_BEGIN( dsP, DS_PROF_CACHE );
+   int latency                 = PIPE_EX_LATENCY_L1HIT;
+   cacheCommT comm             = cacheCommunicate( dsP->l1P, mem, CMD_DIR_READ );
+   if( !comm.hit ){
+      // L1 Miss
+      latency                  = PIPE_EX_LATENCY_L1MISS;
+      comm                     = cacheCommunicate( dsP->l2P, mem, CMD_DIR_READ );
+      if( !comm.hit ){
+         // L2 Miss
+         latency               = PIPE_EX_LATENCY_L2MISS;
+      }
    }
+   DS_PROF_END( dsP, DS_PROF_CACHE );
+   // ----------------- CACHE PLUGIN END ---------------------
+   return latency;
 }
 
 boolean issue( dsPT dsP )
@@ -183,45 +304,26 @@ boolean issue( dsPT dsP )
    //    of the number of instructions in the scheduling queue)
    // 4) Set a timer in the instruction’s data structure that will allow
    //    you to model the execution latency
-   // Clear the old list
-   while( fifoNumElems( dsP->tempQ ) > 0 ){
-      fifoPop( dsP->tempQ );
-   }
-   fifoForeach( dsP->issueList, dsIssuer, dsP );
+   // READY instructions are the marked ones in the issueList, which is
+   // in program order. Pick the oldest N straight off the mark bits
 
    // FUs are pipelined and can take upto N instructions every cycle
    // NOTE: Do not limit executions based on size of executeList as FUs are pipelined
-   int iss              = 0;
-   while( iss < dsP->n && fifoNumElems( dsP->tempQ ) > 0 ){
-      dsInstInfoPT instP= fifoPop( dsP->tempQ );
-      iss++;
+   int numSelect        = fifoOldestMarked( dsP->issueList, dsP->selectP, dsP->n );
+   for( int iss = 0; iss < numSelect; iss++ ){
+      dsInstInfoPT instP= dsP->selectP[iss];
       instP->isDuration = dsP->cycle - instP->isStart;
       instP->exStart    = dsP->cycle;
       instP->stage      = PROC_PIPE_STAGE_EX;
+      dsP->active       = TRUE;
 
       // Memory operation on cache
-      // NOTE: cacheCommunicate is smart enough to return miss if no cache is present
-      // ----------------- CACHE PLUGIN BEGIN -------------------
-      if( instP->type == PROC_INST_TYPE2 && dsP->l1P != NULL ){
-         cacheCommT comm          = cacheCommunicate( dsP->l1P, instP->mem, CMD_DIR_READ );
-         if( !comm.hit ){
-            // L1 Miss
-            instP->latency        = PIPE_EX_LATENCY_L1MISS;
-            comm                  = cacheCommunicate( dsP->l2P, instP->mem, CMD_DIR_READ );
-            if( !comm.hit ){
-               // L2 Miss
-               instP->latency     = PIPE_EX_LATENCY_L2MISS;
-            }
-         } else{
-            // L1 Hit
-            instP->latency        = PIPE_EX_LATENCY_L1HIT;
-         }
-      }
-      // ----------------- CACHE PLUGIN END ---------------------
+      if( instP->type == PROC_INST_TYPE2 && dsP->l1P != NULL )
+         instP->latency = dsCacheAccess( dsP, instP->mem );
 
-      fifoPush( dsP->executeList, instP );
-      // Remove from dispatch list
-      fifoSearchOpRemove( dsP->issueList, dsInstSeqNum, NULL, &(instP->sequenceNum), TRUE );
+      // Remove from issue list by handle, the handle is dead from here on
+      fifoRemoveHandle( dsP->issueList, instP->listHandle );
+      dsWheelInsert( dsP, instP );
    }
 
    return ( fifoNumElems( dsP->issueList ) == 0 ) ? TRUE : FALSE;
@@ -237,16 +339,10 @@ void dsDispatcher( dsPT dsP,  dsInstInfoPT instP )
       instP->ifDuration = dsP->cycle - instP->ifStart;
       instP->idStart    = dsP->cycle;
       instP->stage      = PROC_PIPE_STAGE_ID;
+      dsP->active       = TRUE;
    }
 }
 
-
-boolean dsInstSeqNum( int* seqNum, dsInstInfoPT instP )
-{
-   if( instP->sequenceNum == *seqNum ) return TRUE;
-   return FALSE;
-}
-
 boolean dispatch( dsPT dsP )
 {
    // From the dispatchList, construct a temp list of instructions in the ID
@@ -279,36 +375,45 @@ boolean dispatch( dsPT dsP )
       instP->idDuration              = dsP->cycle - instP->idStart;
       instP->isStart                 = dsP->cycle;
       instP->stage                   = PROC_PIPE_STAGE_IS;
+      dsP->active                    = TRUE;
 
       // Rename destination operands
       if( instP->src1 != -1 ){
-         if( dsP->ready[ instP->src1 ] ){
+         dsRenamePT renameP          = &( dsP->renameTable[ instP->src1 ] );
+         if( renameP->ready ){
             // No need to rename. set ready operand
             instP->src1Ready         = 1;
          } else{
-            // Rename based on mapTable
-            instP->src1              = dsP->mapTable[ instP->src1 ];
+            // Rename to the producer's tag and wait on it
+            dsAddDependent( renameP->producerP, instP, &( instP->deps[0] ), &( instP->src1Ready ) );
+            instP->src1              = renameP->tag;
          }
       }
 
       if( instP->src2 != -1 ){
-         if( dsP->ready[ instP->src2 ] ){
+         dsRenamePT renameP          = &( dsP->renameTable[ instP->src2 ] );
+         if( renameP->ready ){
             // No need to rename. set ready operand
             instP->src2Ready         = 1;
          } else{
-            // Rename based on mapTable
-            instP->src2              = dsP->mapTable[ instP->src2 ];
+            // Rename to the producer's tag and wait on it
+            dsAddDependent( renameP->producerP, instP, &( instP->deps[1] ), &( instP->src2Ready ) );
+            instP->src2              = renameP->tag;
          }
       }
 
       if( instP->dst != -1 ){
          // Renaming needed
-         dsP->ready   [ instP->dst ] = 0;
-         dsP->mapTable[ instP->dst ] = instP->sequenceNum;
+         dsRenamePT renameP          = &( dsP->renameTable[ instP->dst ] );
+         renameP->ready              = 0;
+         renameP->tag                = instP->sequenceNum;
+         renameP->producerP          = instP;
       }
-      fifoPush( dsP->issueList, instP );
-      // Remove from dispatch list
-      fifoSearchOpRemove( dsP->dispatchList, dsInstSeqNum, NULL, &(instP->sequenceNum), TRUE );
+      // Remove from dispatch list by handle before the handle gets reused
+      fifoRemoveHandle( dsP->dispatchList, instP->listHandle );
+      fifoPushHandle( dsP->issueList, instP, &(instP->listHandle) );
+      if( dsInstReady( instP ) )
+         fifoSetMark( dsP->issueList, instP->listHandle );
    }
 
    return ( fifoNumElems( dsP->dispatchList ) == 0 ) ? TRUE : FALSE;
@@ -332,11 +437,17 @@ boolean fetch( dsPT dsP )
    int n2        = 2 * dsP->n;
    while( fifoNumElems( dsP->dispatchList ) < n2 && numFetch < dsP->n ){
       // Fetch new instruction
-      int pc, operation, dst, src1, src2, mem;
-      if( dsP->fetchFP( dsP, &pc, &operation, &dst, &src1, &src2, &mem ) ){
+      addrT pc, mem;
+      int operation, dst, src1, src2;
+      DS_PROF_BEGIN( dsP, DS_PROF_FETCHFP );
+      boolean fetched     = dsP->fetchFP( dsP, &pc, &operation, &dst, &src1, &src2, &mem );
+      DS_PROF_END( dsP, DS_PROF_FETCHFP );
+      if( fetched ){
          numFetch++;
+         dsP->numInstructions++;
+         dsP->active        = TRUE;
          // Create instruction
-         dsInstInfoPT instP = (dsInstInfoPT) calloc( 1, sizeof(dsInstInfoT) );
+         dsInstInfoPT instP = (dsInstInfoPT) poolAlloc( dsP->instPoolP );
          instP->stage       = PROC_PIPE_STAGE_IF;
          instP->ifStart     = dsP->cycle;
          instP->type        = operation;
@@ -358,10 +469,86 @@ boolean fetch( dsPT dsP )
          // Push onto Fake ROB
          fifoPush( dsP->fakeRobP, instP );
          // Add instruction to dispatchList
-         fifoPush( dsP->dispatchList, instP );
+         fifoPushHandle( dsP->dispatchList, instP, &(instP->listHandle) );
       } else{
          return TRUE;
       }
    }
    return FALSE;
 }
+
+// Cache only mode. Sends every memory read of the trace through the same
+// L1/L2 path issue uses, in trace order, with no pipeline at all.
+// Counts instructions but never advances the cycle
+void dsCacheReplay( dsPT dsP )
+{
+   addrT pc, mem;
+   int operation, dst, src1, src2;
+   while( TRUE ){
+      DS_PROF_BEGIN( dsP, DS_PROF_FETCHFP );
+      boolean fetched  = dsP->fetchFP( dsP, &pc, &operation, &dst, &src1, &src2, &mem );
+      DS_PROF_END( dsP, DS_PROF_FETCHFP );
+      if( !fetched ) break;
+      dsP->numInstructions++;
+      if( operation == PROC_INST_TYPE2 && dsP->l1P != NULL )
+         dsCacheAccess( dsP, mem );
+   }
+}
+
+#ifdef DS_PROFILE
+// Profiling clock. The TSC where there is one, nanoseconds otherwise
+inline unsigned long long dsProfNow( void )
+{
+#ifdef DS_PROF_TSC
+   return __rdtsc();
+#else
+   return (unsigned long long) dsProfNs();
+#endif
+}
+
+double dsProfNs( void )
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Breakdown of the profiled sections. Shares are of the wall time since
+// dynamicSchedulerInit, the tick rate is measured over the same span.
+// Nested sections are indented under their parent
+void dsProfPrint( dsPT dsP, FILE* fp )
+{
+   static const char* names[DS_PROF_NUM] = {
+      "fakeRetire", "execute", "issue", "dispatch", "fetch", "  fetchFP", "  cacheCommunicate"
+   };
+   // Print order, cache is called from issue
+   static const int order[DS_PROF_NUM]   = {
+      DS_PROF_RETIRE, DS_PROF_EXECUTE, DS_PROF_ISSUE, DS_PROF_CACHE, DS_PROF_DISPATCH, DS_PROF_FETCH, DS_PROF_FETCHFP
+   };
+
+   double totalTicks    = (double) ( dsProfNow() - dsP->profStartTicks );
+   double totalNs       = dsProfNs() - dsP->profStartNs;
+   double ticksPerNs    = ( totalNs > 0 ) ? totalTicks / totalNs : 1.0;
+   if( totalTicks <= 0 ) totalTicks = 1;
+
+   unsigned long long stageTicks = 0;
+   for( int sec = DS_PROF_RETIRE; sec <= DS_PROF_FETCH; sec++ )
+      stageTicks       += dsP->profTicks[sec];
+
+#ifdef DS_PROF_TSC
+   fprintf( fp, "DS PROFILE (rdtsc, %.2f ticks/ns, %.3f s)\n", ticksPerNs, totalNs * 1e-9 );
+#else
+   fprintf( fp, "DS PROFILE (clock_gettime, %.3f s)\n", totalNs * 1e-9 );
+#endif
+   fprintf( fp, " %-20s %14s %18s %10s %7s\n", "section", "calls", "ticks", "ns/call", "share" );
+   for( int i = 0; i < DS_PROF_NUM; i++ ){
+      int sec           = order[i];
+      unsigned long long calls = dsP->profCalls[sec];
+      unsigned long long ticks = dsP->profTicks[sec];
+      fprintf( fp, " %-20s %14llu %18llu %10.1f %6.1f%%\n", names[sec], calls, ticks,
+               ( calls ) ? ticks / ticksPerNs / calls : 0.0, 100.0 * ticks / totalTicks );
+   }
+   fprintf( fp, " %-20s %14s %18llu %10s %6.1f%%\n", "stages total", "", stageTicks, "",
+            100.0 * stageTicks / totalTicks );
+}
+#endif
@@ -17,6 +17,9 @@
 #include "all.h"
 #include "fifo.h"
 #include "cache.h"
+#include "trace.h"
+#include "pool.h"
+#include "rlog.h"
 
 // Execution latencies
 #define PIPE_EX_LATENCY_TYPE0 0
@@ -28,10 +31,43 @@
 #define PIPE_EX_LATENCY_L1MISS 10
 #define PIPE_EX_LATENCY_L2MISS 20
 
+// Execute stage timing wheel, one bucket per completion cycle.
+// Must be a power of 2 above the longest latency
+#define DS_WHEEL_SIZE          32
+#define DS_WHEEL_MASK          ( DS_WHEEL_SIZE - 1 )
+
+// Self profiling, built in with make PROFILE=1 (-DDS_PROFILE).
+// Every profiled section counts its calls and the ticks spent inside,
+// fetchFP is nested in fetch and cache in issue. Without DS_PROFILE the
+// macros are empty and dsT carries no counters
+typedef enum{
+   DS_PROF_RETIRE       = 0,
+   DS_PROF_EXECUTE      = 1,
+   DS_PROF_ISSUE        = 2,
+   DS_PROF_DISPATCH     = 3,
+   DS_PROF_FETCH        = 4,
+   DS_PROF_FETCHFP      = 5,
+   DS_PROF_CACHE        = 6,
+   DS_PROF_NUM          = 7
+}dsProfT;
+
+#ifdef DS_PROFILE
+#define DS_PROF_BEGIN( dsP, sec )   unsigned long long dsProfStart##sec = dsProfNow()
+#define DS_PROF_END( dsP, sec )     do{ (dsP)->profTicks[sec] += dsProfNow() - dsProfStart##sec; \
+                                        (dsP)->profCalls[sec]++; }while(0)
+#define DS_PROF_PRINT( dsP, fp )    dsProfPrint( dsP, fp )
+#else
+#define DS_PROF_BEGIN( dsP, sec )
+#define DS_PROF_END( dsP, sec )
+#define DS_PROF_PRINT( dsP, fp )
+#endif
+
 // Pointer translations
 typedef  struct  _dsT                 *dsPT;
 typedef  struct  _dsInstInfoT         *dsInstInfoPT;
 typedef  struct  _dsCapsuleT          *dsCapsulePT;
+typedef  struct  _dsDepT              *dsDepPT;
+typedef  struct  _dsRenameT           *dsRenamePT;
 
 // Emums for pipeline stages
 typedef enum{
@@ -48,6 +84,16 @@ typedef enum{
    PROC_INST_TYPE2      = 2
 }procInstructionT;
 
+// Rename table entry.
+// tag/producerP always name the youngest dispatched writer of the
+// register. ready is cleared when it is dispatched and set again only
+// when that same writer completes, so completion is a constant time check
+typedef struct _dsRenameT{
+   int                   ready;
+   countT                tag;
+   dsInstInfoPT          producerP;
+}dsRenameT;
+
 // Dynamic Instruction Scheduler structure.
 typedef struct _dsT{
    /*
@@ -56,65 +102,111 @@ typedef struct _dsT{
    // Placeholder for name
    char                  name[128];
    FILE*                 fp;
+   tracePT               traceP;
    int                   s;
    int                   n;
-   boolean               (*fetchFP)( dsPT, int*, int*, int*, int*, int*, int* ); 
-   int                   seqNum;
-   int                   ready[128];
-   int                   mapTable[128];
-   int                   cycle;
+   boolean               (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* ); 
+   countT                seqNum;
+   // Instructions read from the trace so far
+   countT                numInstructions;
+   // Register rename table, one entry per architectural register
+   dsRenameT             renameTable[128];
+   countT                cycle;
    cachePT               l1P;
    cachePT               l2P;
 
    // Circular FIFO
    fifoPT                fakeRobP;
 
-   // 3 Lists
+   // 2 Lists and the execute wheel
    // Dispatch list a.k.a dispatch queue: size:= 2n
    fifoPT                dispatchList;
    // Issue list a.k.a scheduling queue : size:= s
+   // Ready instructions carry the FIFO mark bit
    fifoPT                issueList;
-   // Exectute list a.k.a FU            : size:= n
-   fifoPT                executeList;
+   // Exectute list a.k.a FU, bucketed by completion cycle. Each bucket
+   // is kept in program order
+   dsInstInfoPT          wheelHeadP[DS_WHEEL_SIZE];
+   dsInstInfoPT          wheelTailP[DS_WHEEL_SIZE];
+   int                   numExecuting;
 
    // TempQ
    fifoPT                tempQ;
+   // Instructions picked by issue this cycle, N entries
+   void**                selectP;
+
+   // Backing store for dsInstInfoT, recycled at retire
+   poolPT                instPoolP;
+
+   // Retire log, NULL when disabled
+   rlogPT                rlogP;
+
+   // Event driven time advance. Stages set active on any state change,
+   // a cycle without one is skipped ahead to the next EX completion
+   boolean               eventDriven;
+   boolean               active;
+   countT                skippedCycles;
+
+#ifdef DS_PROFILE
+   // Per section ticks and calls, indexed by dsProfT. The start stamps
+   // give the whole run and the tick rate
+   unsigned long long    profTicks[DS_PROF_NUM];
+   unsigned long long    profCalls[DS_PROF_NUM];
+   unsigned long long    profStartTicks;
+   double                profStartNs;
+#endif
 }dsT;
 
+// Consumer side link of a producer's dependents list
+// Lives inside the consumer, one per source operand
+typedef struct _dsDepT{
+   dsInstInfoPT        consumerP;
+   int*                readyP;      // Consumer's src1Ready/src2Ready
+   dsDepPT             nextP;
+}dsDepT;
+
 // Container for "Fake ROB" for storing per instruction info
 typedef struct _dsInstInfoT{
    procPipeStageT      stage;       // State like WB, EX
    int                 type;        // Type of instruction
 
    // Operands that wud be renamed
-   int                 src1;
-   int                 src2;
+   countT              src1;
+   countT              src2;
    // Original operands
    int                 origSrc1;
    int                 origSrc2;
    int                 dst;
    int                 latency;
-   int                 mem;
+   addrT               mem;
 
    int                 src1Ready;    // Src1 ready state
    int                 src2Ready;    // Src2 ready state
 
-   int                 sequenceNum; // Tag or sequence number
+   // Wakeup links. Consumers renamed to this instruction hang off
+   // depHeadP, deps[] are this instruction's own links on its producers
+   dsDepPT             depHeadP;
+   dsDepT              deps[2];
+
+   countT              sequenceNum; // Tag or sequence number
+   int                 listHandle;  // Slot in dispatch/issue list
+   countT              exFinish;    // Cycle in which execute completes
+   dsInstInfoPT        wheelNextP;  // Next in the same wheel bucket
 
    // Timing related info
-   int                 ifStart;
+   countT              ifStart;
    int                 ifDuration;
 
-   int                 idStart;
+   countT              idStart;
    int                 idDuration;
 
-   int                 isStart;
+   countT              isStart;
    int                 isDuration;
 
-   int                 exStart;
+   countT              exStart;
    int                 exDuration;
 
-   int                 wbStart;
+   countT              wbStart;
    int                 wbDuration;
 }dsInstInfoT;
 
@@ -128,9 +220,10 @@ typedef struct _dsCapsuleT{
 dsPT  dynamicSchedulerInit(   
          char*              name, 
          FILE*              fp,
+         tracePT            traceP,
          int                s,
          int                n,
-         boolean            (*fetchFP)( dsPT, int*, int*, int*, int*, int*, int* ), 
+         boolean            (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* ), 
          int                blockSize,
          int                l1Size,
          int                l1Assoc,
@@ -138,19 +231,27 @@ dsPT  dynamicSchedulerInit(
          int                l2Assoc
       );
 
+void       dsDestroy( dsPT dsP );
 boolean    dsProcess( dsPT dsP );
-boolean    dsInstInEx( dsPT dsP, dsInstInfoPT  instP );
+countT     dsNextEvent( dsPT dsP );
+void       dsWheelInsert( dsPT dsP, dsInstInfoPT instP );
 boolean    dsInstInWB( dsInstInfoPT  instP );
 boolean    fakeRetire( dsPT dsP );
-void       dsWakeup( int *reg,  dsInstInfoPT instP );
-void       dsSearchDst( int *dstFlag,  dsInstInfoPT instP );
+boolean    dsInstReady( dsInstInfoPT instP );
+void       dsWakeup( dsPT dsP, dsInstInfoPT instP );
+void       dsAddDependent( dsInstInfoPT producerP, dsInstInfoPT consumerP, dsDepPT depP, int* readyP );
 void       dsExFinish( dsPT dsP, dsInstInfoPT instP );
 boolean    execute( dsPT dsP );
-void       dsIssuer( dsPT dsP,  dsInstInfoPT instP );
+int        dsCacheAccess( dsPT dsP, addrT mem );
 boolean    issue( dsPT dsP );
 void       dsDispatcher( dsPT dsP,  dsInstInfoPT instP );
-boolean    dsInstSeqNum( int* seqNum, dsInstInfoPT instP );
 boolean    dispatch( dsPT dsP );
 boolean    fetch( dsPT dsP );
+void       dsCacheReplay( dsPT dsP );
+#ifdef DS_PROFILE
+unsigned long long dsProfNow( void );
+double     dsProfNs( void );
+void       dsProfPrint( dsPT dsP, FILE* fp );
+#endif
 
 #endif
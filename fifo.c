@@ -11,68 +11,204 @@
 #include "fifo.h"
 
 // Allocates and inits all internal variables
-fifoPT  fifoInit()
+// capacity is only a hint, the FIFO grows if it is exceeded
+fifoPT  fifoInit( int capacity )
 {
    // Calloc the mem to reset all vars to 0
    fifoPT fifoP                      = (fifoPT) calloc( 1, sizeof(fifoT) );
    ASSERT( !fifoP, "Unable to create FIFO" );
 
-   fifoP->head                       = NULL;
-   fifoP->tail                       = NULL;
-   fifoP->numElems                   = 0;
+   // Power of 2 so that wrapping is a mask
+   int size                          = 1;
+   while( size < capacity )
+      size                         <<= 1;
+   fifoRebuild( fifoP, size );
 
    return fifoP;
 }
 
-// Interface to create new cells
-fifoCellPT fifoCreateCell( void* payload )
+// Frees the FIFO itself, payloads belong to the caller
+void fifoDestroy( fifoPT fifoP )
 {
-   fifoCellPT cellP                  = (fifoCellPT) calloc( 1, sizeof(fifoCellT) );
-   ASSERT( !cellP, "Unable to create FIFO cells" );
+   if( !fifoP ) return;
+   free( fifoP->payloadP );
+   free( fifoP->handlePP );
+   free( fifoP->markP );
+   free( fifoP );
+}
+
+// Moves the live payloads to fresh storage of the given capacity,
+// squeezing out the holes and patching registered handles
+void fifoRebuild( fifoPT fifoP, int capacity )
+{
+   void** payloadP                   = (void**) calloc( capacity, sizeof(void*) );
+   int**  handlePP                   = (int**)  calloc( capacity, sizeof(int*) );
+   unsigned long long* markP         = (unsigned long long*) calloc( ( capacity + 63 ) / 64, sizeof(unsigned long long) );
+   ASSERT( !payloadP || !handlePP || !markP, "Unable to create FIFO storage" );
+
+   int numElems                      = 0;
+   for( int pos = 0; pos < fifoP->span; pos++ ){
+      int slot                       = ( fifoP->start + pos ) & fifoP->mask;
+      if( fifoP->payloadP[slot] == NULL ) continue;
+      payloadP[numElems]             = fifoP->payloadP[slot];
+      handlePP[numElems]             = fifoP->handlePP[slot];
+      if( handlePP[numElems] != NULL )
+         *handlePP[numElems]         = numElems;
+      if( fifoIsMarked( fifoP, slot ) )
+         markP[ numElems / 64 ]     |= 1ULL << ( numElems % 64 );
+      numElems++;
+   }
 
-   cellP->next                       = NULL;
-   cellP->prev                       = NULL;
-   cellP->payload                    = payload;
-   return cellP;
+   free( fifoP->payloadP );
+   free( fifoP->handlePP );
+   free( fifoP->markP );
+   fifoP->payloadP                   = payloadP;
+   fifoP->handlePP                   = handlePP;
+   fifoP->markP                      = markP;
+   fifoP->capacity                   = capacity;
+   fifoP->mask                       = capacity - 1;
+   fifoP->start                      = 0;
+   fifoP->span                       = numElems;
+   fifoP->numElems                   = numElems;
 }
 
-void fifoPush( fifoPT fifoP, void* payload )
+// Squeezes out the holes without touching the heap. Payloads slide back
+// towards start in ring order, so a slot is only written once its own
+// payload has been moved. Marks and registered handles move along
+void fifoCompact( fifoPT fifoP )
+{
+   int numElems                      = 0;
+   for( int pos = 0; pos < fifoP->span; pos++ ){
+      int slot                       = ( fifoP->start + pos ) & fifoP->mask;
+      if( fifoP->payloadP[slot] == NULL ) continue;
+      int dst                        = ( fifoP->start + numElems ) & fifoP->mask;
+      numElems++;
+      if( dst == slot ) continue;
+
+      fifoP->payloadP[dst]           = fifoP->payloadP[slot];
+      fifoP->handlePP[dst]           = fifoP->handlePP[slot];
+      fifoP->payloadP[slot]          = NULL;
+      fifoP->handlePP[slot]          = NULL;
+      if( fifoP->handlePP[dst] != NULL )
+         *fifoP->handlePP[dst]       = dst;
+      if( fifoIsMarked( fifoP, slot ) ){
+         fifoP->markP[ slot / 64 ]  &= ~( 1ULL << ( slot % 64 ) );
+         fifoP->markP[ dst / 64 ]   |= 1ULL << ( dst % 64 );
+      }
+   }
+   fifoP->span                       = numElems;
+}
+
+// Payload at position pos counted from the tail (0 == oldest), holes
+// included. NULL for a hole
+inline void* fifoAt( fifoPT fifoP, int pos )
 {
-   // Create a new cell
-   fifoCellPT cellP                  = fifoCreateCell( payload );
-
-   // Add newly created node to head
-   cellP->next                       = fifoP->head;
-   if( fifoP->head != NULL )
-      fifoP->head->prev              = cellP;
-   fifoP->head                       = cellP;
-   if( fifoP->tail == NULL )
-      fifoP->tail                    = fifoP->head;
+   return fifoP->payloadP[ ( fifoP->start + pos ) & fifoP->mask ];
+}
+
+// Leaves a hole at position pos and trims holes off both ends
+// Positions of the other payloads do not change, except that trimming
+// the tail shifts all positions down. Handles (slots) never change
+void fifoRemoveAt( fifoPT fifoP, int pos )
+{
+   int slot                          = ( fifoP->start + pos ) & fifoP->mask;
+   fifoP->payloadP[slot]             = NULL;
+   fifoP->handlePP[slot]             = NULL;
+   fifoP->markP[ slot / 64 ]        &= ~( 1ULL << ( slot % 64 ) );
+   fifoP->numElems--;
+
+   while( fifoP->span > 0 && fifoAt( fifoP, fifoP->span - 1 ) == NULL )
+      fifoP->span--;
+   while( fifoP->span > 0 && fifoAt( fifoP, 0 ) == NULL ){
+      fifoP->start                   = ( fifoP->start + 1 ) & fifoP->mask;
+      fifoP->span--;
+   }
+}
+
+// Adds to head and keeps *handleP pointing at the payload's slot for as
+// long as it stays in the FIFO
+void fifoPushHandle( fifoPT fifoP, void* payload, int* handleP )
+{
+   ASSERT( payload == NULL, "NULL can not be pushed to a FIFO" );
+   if( fifoP->span == fifoP->capacity ){
+      // More than half full: double, else just squeeze out the holes
+      if( 2 * fifoP->numElems > fifoP->capacity )
+         fifoRebuild( fifoP, 2 * fifoP->capacity );
+      else
+         fifoCompact( fifoP );
+   }
+
+   int slot                          = ( fifoP->start + fifoP->span ) & fifoP->mask;
+   fifoP->payloadP[slot]             = payload;
+   fifoP->handlePP[slot]             = handleP;
+   if( handleP != NULL )
+      *handleP                       = slot;
+   fifoP->span++;
    fifoP->numElems++;
 }
 
+void fifoPush( fifoPT fifoP, void* payload )
+{
+   fifoPushHandle( fifoP, payload, NULL );
+}
+
+// O(1) removal of a payload pushed with fifoPushHandle
+void fifoRemoveHandle( fifoPT fifoP, int handle )
+{
+   ASSERT( fifoP->payloadP[handle] == NULL, "Stale FIFO handle: %d", handle );
+   fifoRemoveAt( fifoP, ( handle - fifoP->start ) & fifoP->mask );
+}
+
+// Marks stay with the payload until it is removed
+inline void fifoSetMark( fifoPT fifoP, int handle )
+{
+   fifoP->markP[ handle / 64 ]      |= 1ULL << ( handle % 64 );
+}
+
+inline boolean fifoIsMarked( fifoPT fifoP, int handle )
+{
+   return ( fifoP->markP == NULL ) ? FALSE : ( fifoP->markP[ handle / 64 ] >> ( handle % 64 ) ) & 1;
+}
+
+// Collects marked payloads of slots [from, to) in slot order into outP,
+// which already holds count of them. Stops at max
+int fifoScanMarks( fifoPT fifoP, int from, int to, void** outP, int count, int max )
+{
+   for( int word = from / 64; word * 64 < to && count < max; word++ ){
+      unsigned long long bits        = fifoP->markP[word];
+      // Drop the bits outside [from, to)
+      if( word == from / 64 )
+         bits                       &= ~0ULL << ( from % 64 );
+      if( ( word + 1 ) * 64 > to )
+         bits                       &= ~0ULL >> ( 64 - to % 64 );
+      while( bits != 0 && count < max ){
+         outP[count++]               = fifoP->payloadP[ word * 64 + __builtin_ctzll( bits ) ];
+         bits                       &= bits - 1;
+      }
+   }
+   return count;
+}
+
+// Collects up to max marked payloads, oldest first. Returns how many
+int fifoOldestMarked( fifoPT fifoP, void** outP, int max )
+{
+   int end                           = fifoP->start + fifoP->span;
+   if( end <= fifoP->capacity )
+      return fifoScanMarks( fifoP, fifoP->start, end, outP, 0, max );
+
+   // Span wraps around the end of the ring
+   int count                         = fifoScanMarks( fifoP, fifoP->start, fifoP->capacity, outP, 0, max );
+   return fifoScanMarks( fifoP, 0, end - fifoP->capacity, outP, count, max );
+}
+
 void* fifoPop( fifoPT fifoP )
 {
    // Check underflow
    if( fifoP->numElems == 0 ) return NULL;
 
-   // Get payload
-   void* payload                     = fifoP->head->payload;
-   
-   // Store the pointer to head
-   fifoCellPT cellP                  = fifoP->head;
-
-   // Update head
-   fifoP->head                       = fifoP->head->next;
-   if( fifoP->head != NULL )
-      fifoP->head->prev              = NULL;
-   else
-      fifoP->tail                    = NULL;
-
-   // Free the deleted link
-   free( cellP );
-   fifoP->numElems--;
-
+   // Remove from head. Ends never hold a hole
+   void* payload                     = fifoAt( fifoP, fifoP->span - 1 );
+   fifoRemoveAt( fifoP, fifoP->span - 1 );
    return payload;
 }
 
@@ -81,32 +217,18 @@ void* fifoPopTail( fifoPT fifoP )
    // Check underflow
    if( fifoP->numElems == 0 ) return NULL;
 
-   // Get payload
-   void* payload                     = fifoP->tail->payload;
-   
-   // Store the pointer to tail
-   fifoCellPT cellP                  = fifoP->tail;
-
-   // Update tail
-   fifoP->tail                       = fifoP->tail->prev;
-   if( fifoP->tail != NULL )
-      fifoP->tail->next              = NULL;
-   else
-      fifoP->head                    = NULL;
-
-   // Free the deleted link
-   free( cellP );
-   fifoP->numElems--;
-
+   // Remove from tail. Ends never hold a hole
+   void* payload                     = fifoAt( fifoP, 0 );
+   fifoRemoveAt( fifoP, 0 );
    return payload;
 }
 
 void* fifoPopConditional( fifoPT fifoP, boolean* success, boolean (*funcP)() )
 {
    *success    = FALSE;
-   if( !fifoP || !fifoP->head ) return NULL;
+   if( !fifoP || fifoP->numElems == 0 ) return NULL;
 
-   if( funcP( fifoP->head->payload ) ){
+   if( funcP( fifoAt( fifoP, fifoP->span - 1 ) ) ){
       *success = TRUE;
       return fifoPop( fifoP );
    }
@@ -116,135 +238,94 @@ void* fifoPopConditional( fifoPT fifoP, boolean* success, boolean (*funcP)() )
 void* fifoPopTailConditional( fifoPT fifoP, boolean* success, boolean (*funcP)() )
 {
    *success    = FALSE;
-   if( !fifoP || !fifoP->tail ) return NULL;
+   if( !fifoP || fifoP->numElems == 0 ) return NULL;
 
-   if( funcP( fifoP->tail->payload ) ){
+   if( funcP( fifoAt( fifoP, 0 ) ) ){
       *success = TRUE;
       return fifoPopTail( fifoP );
    }
    return NULL;
 }
 
-// For each
+// For each, head to tail
 int fifoForeach( fifoPT fifoP, void (*funcOpP)(), void* userData )
 {
-   if( !fifoP || !fifoP->head ) return 0;
+   if( !fifoP ) return 0;
 
-   fifoCellPT temp      = fifoP->head;
    int cnt = 0;
-   while( temp != NULL ){
-      funcOpP( userData, temp->payload );
-      temp              = temp->next;
+   for( int pos = fifoP->span - 1; pos >= 0; pos-- ){
+      void* payload     = fifoAt( fifoP, pos );
+      if( payload == NULL ) continue;
+      funcOpP( userData, payload );
       cnt++;
    }
    return cnt;
 }
 
+// For each, tail to head
 int fifoForeachInv( fifoPT fifoP, void (*funcOpP)(), void* userData )
 {
-   if( !fifoP || !fifoP->tail ) return 0;
+   if( !fifoP ) return 0;
 
-   fifoCellPT temp      = fifoP->tail;
    int cnt = 0;
-   while( temp != NULL ){
-      funcOpP( userData, temp->payload );
-      temp              = temp->prev;
+   for( int pos = 0; pos < fifoP->span; pos++ ){
+      void* payload     = fifoAt( fifoP, pos );
+      if( payload == NULL ) continue;
+      funcOpP( userData, payload );
       cnt++;
    }
    return cnt;
 }
 
-// Search, operate (dealloc payload) and remove
+// Search, operate (dealloc payload) and remove, head to tail
+// funcOpP sees the FIFO with the payload still in it
 int fifoSearchOpRemove( fifoPT fifoP, boolean (*funcCondP)(), void (*funcOpP)(), void* userData, boolean breakOnFind )
 {
-   if( !fifoP || !fifoP->head ) return 0;
+   if( !fifoP ) return 0;
    int count            = 0;
 
-   fifoCellPT temp      = fifoP->head;
-   while( temp != NULL ){
+   // Trimming only moves start when the tail itself is removed, which
+   // is the last position visited, so pos stays valid
+   for( int pos = fifoP->span - 1; pos >= 0; pos-- ){
+      void* payload     = fifoAt( fifoP, pos );
       // Search
-      if( funcCondP( userData, temp->payload ) ){
+      if( payload != NULL && funcCondP( userData, payload ) ){
          if( funcOpP != NULL )
-            funcOpP( userData, temp->payload );
+            funcOpP( userData, payload );
 
          // Remove
-         // Unlink the node
-         fifoCellPT delCell     = temp;
-
-         if( delCell->prev != NULL ){
-            delCell->prev->next = delCell->next;
-         } else {
-            // Node to be deleted is the head node
-            fifoP->head         = delCell->next;
-            if( fifoP->head != NULL )
-               fifoP->head->prev= NULL;
-         }
-
-         if( delCell->next != NULL ){
-            delCell->next->prev = delCell->prev;
-         } else{
-            // Node to be deleted is the tail node
-            fifoP->tail         = delCell->prev;
-            if( fifoP->tail != NULL )
-               fifoP->tail->next   = NULL;
-         }
-
-         // Update temp to continue iteration
-         temp                   = delCell->next;
-         free( delCell );
+         fifoRemoveAt( fifoP, pos );
          count++;
-         fifoP->numElems--;
          if( breakOnFind ) break;
-      } else{
-         temp              = temp->next;
       }
    }
    return count;
 }
 
-// Search, operate (dealloc payload) and remove
+// Search, operate (dealloc payload) and remove, tail to head
+// funcOpP sees the FIFO with the payload still in it
 int fifoSearchOpRemoveInv( fifoPT fifoP, boolean (*funcCondP)(), void (*funcOpP)(), void* userData, boolean breakOnFind )
 {
-   if( !fifoP || !fifoP->head ) return 0;
+   if( !fifoP ) return 0;
    int count            = 0;
 
-   fifoCellPT temp      = fifoP->tail;
-   while( temp != NULL ){
+   int pos              = 0;
+   while( pos < fifoP->span ){
+      void* payload     = fifoAt( fifoP, pos );
       // Search
-      if( funcCondP( userData, temp->payload ) ){
+      if( payload != NULL && funcCondP( userData, payload ) ){
          if( funcOpP != NULL )
-            funcOpP( userData, temp->payload );
+            funcOpP( userData, payload );
 
-         // Remove
-         // Unlink the node
-         fifoCellPT delCell     = temp;
-
-         if( delCell->prev != NULL ){
-            delCell->prev->next = delCell->next;
-         } else {
-            // Node to be deleted is the head node
-            fifoP->head         = delCell->next;
-            if( fifoP->head != NULL )
-               fifoP->head->prev= NULL;
-         }
-
-         if( delCell->next != NULL ){
-            delCell->next->prev = delCell->prev;
-         } else{
-            // Node to be deleted is the tail node
-            fifoP->tail         = delCell->prev;
-            if( fifoP->tail != NULL )
-               fifoP->tail->next   = NULL;
-         }
-
-         // Update temp to continue iteration
-         temp                   = delCell->prev;
-         free( delCell );
+         // Remove. If that trimmed the tail, start now sits on the next
+         // payload to visit
+         int start      = fifoP->start;
+         fifoRemoveAt( fifoP, pos );
          count++;
-         fifoP->numElems--;
          if( breakOnFind ) break;
+         pos            = ( start != fifoP->start ) ? 0 : pos + 1;
       } else{
-         temp              = temp->prev;
+         pos++;
       }
    }
    return count;
@@ -252,15 +333,19 @@ int fifoSearchOpRemoveInv( fifoPT fifoP, boolean (*funcCondP)(), void (*funcOpP)
 
 void* fifoPeekNth( fifoPT fifoP, int n, boolean* success )
 {
-   if( n >= fifoP->numElems ) { *success = FALSE; return NULL; }
-
-   fifoCellPT temp      = fifoP->head;
-   for( int i = 0; i < n; i++ ){
-      temp              = temp->next;
+   *success             = FALSE;
+   if( n >= fifoP->numElems ) return NULL;
+
+   // n is counted from head, holes do not count
+   for( int pos = fifoP->span - 1; pos >= 0; pos-- ){
+      void* payload     = fifoAt( fifoP, pos );
+      if( payload == NULL ) continue;
+      if( n-- == 0 ){
+         *success       = TRUE;
+         return payload;
+      }
    }
-   ASSERT( !temp, "Illegal (NULL) value found at the nth(=%d) link of FIFO", n );
-   *success             = TRUE;
-   return temp->payload;
+   return NULL;
 }
 
 inline int fifoNumElems( fifoPT fifoP )
@@ -18,24 +18,44 @@
 
 // Pointer translations
 typedef  struct  _fifoT                 *fifoPT;
-typedef  struct  _fifoCellT             *fifoCellPT;
 
 // Generic FIFO structure.
+// Payloads live in one contiguous ring ordered from tail (oldest, slot
+// "start") to head (youngest). Removing from the middle only leaves a
+// hole (NULL payload) behind, so nothing moves and a payload can be
+// addressed by its slot (handle) until it is removed. Holes at either
+// end are trimmed right away. When the span from tail to head reaches
+// the capacity the ring is compacted, or doubled if it is more than half
+// full, and the registered handles are patched. Steady state pushes and
+// removals never allocate.
+// Each slot also carries a mark bit, packed 64 to a word, so that the
+// oldest marked payloads can be picked with a few ctz per 64 slots
 typedef struct _fifoT{
-   fifoCellPT          head;
-   fifoCellPT          tail;
+   void**              payloadP;
+   // Owner's copy of the handle for each slot, NULL if not tracked
+   int**               handlePP;
+   unsigned long long* markP;
+   int                 capacity;
+   int                 mask;
+   int                 start;
+   // Slots from tail to head, holes included
+   int                 span;
    int                 numElems;
 }fifoT;
 
-typedef struct _fifoCellT{
-   fifoCellPT          next;
-   fifoCellPT          prev;
-   void*               payload;
-}fifoCellT;
-
-fifoPT     fifoInit();
-fifoCellPT fifoCreateCell( void* payload );
+fifoPT     fifoInit( int capacity );
+void       fifoDestroy( fifoPT fifoP );
+void       fifoRebuild( fifoPT fifoP, int capacity );
+void       fifoCompact( fifoPT fifoP );
+void*      fifoAt( fifoPT fifoP, int pos );
+void       fifoRemoveAt( fifoPT fifoP, int pos );
 void       fifoPush( fifoPT fifoP, void* payload );
+void       fifoPushHandle( fifoPT fifoP, void* payload, int* handleP );
+void       fifoRemoveHandle( fifoPT fifoP, int handle );
+void       fifoSetMark( fifoPT fifoP, int handle );
+boolean    fifoIsMarked( fifoPT fifoP, int handle );
+int        fifoScanMarks( fifoPT fifoP, int from, int to, void** outP, int count, int max );
+int        fifoOldestMarked( fifoPT fifoP, void** outP, int max );
 void*      fifoPop( fifoPT fifoP );
 void*      fifoPopTail( fifoPT fifoP );
 void*      fifoPeekNth( fifoPT fifoP, int n, boolean* success );
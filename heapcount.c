@@ -0,0 +1,40 @@
+/*H**********************************************************************
+* FILENAME    :       heapcount.c 
+* DESCRIPTION :       Counts every heap call made by sim
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "heapcount.h"
+
+// sim is linked with --wrap=malloc,--wrap=calloc,--wrap=realloc, so every
+// heap call made from its objects comes through here first. A word sized
+// counter stays lock free in the 32 bit build too; sweep and replay
+// workers allocate concurrently
+long heapCount                       = 0;
+
+long heapCalls( void )
+{
+   return __atomic_load_n( &heapCount, __ATOMIC_RELAXED );
+}
+
+void* __wrap_malloc( size_t size )
+{
+   __atomic_fetch_add( &heapCount, 1, __ATOMIC_RELAXED );
+   return __real_malloc( size );
+}
+
+void* __wrap_calloc( size_t numObjs, size_t size )
+{
+   __atomic_fetch_add( &heapCount, 1, __ATOMIC_RELAXED );
+   return __real_calloc( numObjs, size );
+}
+
+void* __wrap_realloc( void* ptr, size_t size )
+{
+   __atomic_fetch_add( &heapCount, 1, __ATOMIC_RELAXED );
+   return __real_realloc( ptr, size );
+}
@@ -0,0 +1,27 @@
+/*H**********************************************************************
+* FILENAME    :       heapcount.h
+* DESCRIPTION :       Contains prototypes for counting the heap calls
+*                     of sim
+* NOTES       :       Only sim links heapcount.o, together with
+*                     -Wl,--wrap for malloc/calloc/realloc
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _HEAPCOUNT_H
+#define _HEAPCOUNT_H
+
+#include "all.h"
+
+long       heapCalls( void );
+void*      __real_malloc( size_t size );
+void*      __real_calloc( size_t numObjs, size_t size );
+void*      __real_realloc( void* ptr, size_t size );
+void*      __wrap_malloc( size_t size );
+void*      __wrap_calloc( size_t numObjs, size_t size );
+void*      __wrap_realloc( void* ptr, size_t size );
+#endif
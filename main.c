@@ -12,40 +12,182 @@
 
 #include "all.h"
 #include "ds.h"
+#include "sweep.h"
+#include "stackdist.h"
+#include "replay.h"
+#include "heapcount.h"
 
-int numInstructions = 0;
+// Sanity checks common to all trace readers
+void doTraceCheck( int operation, int dst, int src1, int src2 )
+{
+   // Operation can only be 0, 1 or 2
+   ASSERT( !( operation >= 0 && operation <= 2 ), "Operation can only be 0, 1 or 2");
+
+   // Register can be from -1 to 127
+   ASSERT(!(dst  >= -1 && dst  <= 127), "dst reg out of bounds[-1, 127]: %d\n", dst);
+   ASSERT(!(src1 >= -1 && src1 <= 127), "src1 reg out of bounds[-1, 127]: %d\n", src1);
+   ASSERT(!(src2 >= -1 && src2 <= 127), "src2 reg out of bounds[-1, 127]: %d\n", src2);
+}
 
 // Trace function to be mapped with init
-boolean doTrace( dsPT dsP, int* pcP, int* operationP, int* dstP, int* src1P, int* src2P, int* memP )
+// Stdio based reader. Used only when the trace can not be memory mapped
+boolean doTrace( dsPT dsP, addrT* pcP, int* operationP, int* dstP, int* src1P, int* src2P, addrT* memP )
 {
-   int pc, operation, dst, src1, src2, mem;
+   uaddrT pc, mem;
+   int operation, dst, src1, src2;
    if( !feof(dsP->fp) ){
-      int bytesRead = fscanf( dsP->fp, "%x %d %d %d %d %x\n", &pc, &operation, &dst, &src1, &src2, &mem );
+      int bytesRead = fscanf( dsP->fp, "%" PRIaddr " %d %d %d %d %" PRIaddr "\n", &pc, &operation, &dst, &src1, &src2, &mem );
       // Just to safeguard on byte reading
       ASSERT(bytesRead <= 0, "fscanf read nothing!");
 
-      // Operation can only be 0, 1 or 2
-      ASSERT( !( operation >= 0 && operation <= 2 ), "Operation can only be 0, 1 or 2");
+      doTraceCheck( operation, dst, src1, src2 );
 
-      // Register can be from -1 to 127
-      ASSERT(!(dst  >= -1 && dst  <= 127), "dst reg out of bounds[-1, 127]: %d\n", dst);
-      ASSERT(!(src1 >= -1 && src1 <= 127), "src1 reg out of bounds[-1, 127]: %d\n", src1);
-      ASSERT(!(src2 >= -1 && src2 <= 127), "src2 reg out of bounds[-1, 127]: %d\n", src2);
-
-      *pcP        = pc;
+      *pcP        = (addrT) pc;
       *operationP = operation;
       *dstP       = dst;
       *src1P      = src1;
       *src2P      = src2;
-      *memP       = mem;
-      numInstructions++;
+      *memP       = (addrT) mem;
+      return TRUE;
+   }
+   return FALSE;
+}
+
+// Trace function to be mapped with init
+// Parses straight out of the memory mapped trace
+boolean doTraceMapped( dsPT dsP, addrT* pcP, int* operationP, int* dstP, int* src1P, int* src2P, addrT* memP )
+{
+   traceRecT rec;
+   if( traceRead( dsP->traceP, &rec ) ){
+      doTraceCheck( rec.operation, rec.dst, rec.src1, rec.src2 );
+
+      *pcP        = rec.pc;
+      *operationP = rec.operation;
+      *dstP       = rec.dst;
+      *src1P      = rec.src1;
+      *src2P      = rec.src2;
+      *memP       = rec.mem;
       return TRUE;
    }
    return FALSE;
 }
 
+void usage()
+{
+   printf( "Usage: sim <S> <N> <BLOCKSIZE> <L1_size> <L1_assoc> <L2_size> <L2_assoc> <tracefile> [options]\n" );
+   printf( "       sim --sweep <configfile> <tracefile> [--threads=<T>] [--event]\n" );
+   printf( "       sim --stackdist <BLOCKSIZE> <tracefile> [--l1=<size>,<assoc>] [--max-assoc=<A>]\n" );
+   printf( "                       [--max-sets-log=<K>] [--validate]\n" );
+   printf( "Options:\n" );
+   printf( "   --async          Decode the trace on a background thread\n" );
+   printf( "   --stats          Print simulator internal statistics to stderr\n" );
+   printf( "   --event          Skip cycles in which no pipeline state can change\n" );
+   printf( "   --cache-only     Replay the trace's memory reads through L1/L2 in trace\n" );
+   printf( "                    order without the pipeline. Prints cache contents only\n" );
+   printf( "   --threads=<T>    With --cache-only, split the cache sets over T threads\n" );
+   printf( "   --retire-log=<text|bin|none>\n" );
+   printf( "                    Format of the per instruction retire log (default text)\n" );
+   printf( "   --retire-log-file=<file>\n" );
+   printf( "                    Write the retire log to <file> instead of stdout\n" );
+   printf( "   --retire-log-async\n" );
+   printf( "                    Write the retire log on a background thread\n" );
+   printf( "Sweep mode runs every \"S N BLOCKSIZE L1_size L1_assoc L2_size L2_assoc\" line of\n" );
+   printf( "<configfile> over one decoded copy of the trace on T threads (default one per\n" );
+   printf( "CPU) and prints one result row per configuration. No retire log is written\n" );
+   printf( "Stack distance mode prints LRU read misses for every power of 2 cache size and\n" );
+   printf( "associativity up to A ways and 2^K sets, from one pass over the trace's memory\n" );
+   printf( "accesses in trace order. --l1 profiles only the misses of that L1, for sizing\n" );
+   printf( "an L2. --validate checks a few points against the cache model\n" );
+   exit(1);
+}
+
+// Many configurations, one trace
+int mainSweep( int argc, char** argv )
+{
+   if( argc < 4 ) usage();
+
+   int numThreads          = 0;
+   boolean event           = FALSE;
+   for( int argIndex = 4; argIndex < argc; argIndex++ ){
+      char* argP           = argv[argIndex];
+      if(      strncmp( argP, "--threads=", 10 ) == 0 ) numThreads = atoi( argP + 10 );
+      else if( strcmp( argP, "--event" ) == 0 ) event = TRUE;
+      else usage();
+   }
+
+   sweepPT sweepP          = sweepInit( argv[2], argv[3], event, doTraceMapped );
+   sweepRun( sweepP, numThreads );
+   sweepPrintResults( sweepP, stdout );
+   sweepDestroy( sweepP );
+   return 0;
+}
+
+// All LRU cache sizes in one pass
+int mainStackDist( int argc, char** argv )
+{
+   if( argc < 4 ) usage();
+
+   int blockSize           = atoi( argv[2] );
+   int l1Size              = 0;
+   int l1Assoc             = 0;
+   int maxAssoc            = SD_MAX_ASSOC;
+   int maxSetsLog          = SD_MAX_SETS_LOG;
+   boolean validate        = FALSE;
+   for( int argIndex = 4; argIndex < argc; argIndex++ ){
+      char* argP           = argv[argIndex];
+      if(      strncmp( argP, "--l1=", 5 ) == 0 ){
+         if( sscanf( argP + 5, "%d,%d", &l1Size, &l1Assoc ) != 2 ) usage();
+      }
+      else if( strncmp( argP, "--max-assoc=", 12 ) == 0 ) maxAssoc = atoi( argP + 12 );
+      else if( strncmp( argP, "--max-sets-log=", 15 ) == 0 ) maxSetsLog = atoi( argP + 15 );
+      else if( strcmp( argP, "--validate" ) == 0 ) validate = TRUE;
+      else usage();
+   }
+
+   tracePT traceP          = traceOpen( argv[3] );
+   ASSERT(!traceP, "Unable to read file: %s\n", argv[3]);
+
+   // Optional filter: only what misses in this L1 reaches the profiled level
+   cachePT l1P             = cacheInit( "L1", l1Size, l1Assoc, blockSize, 0, POLICY_REP_LRU, POLICY_WRITE_BACK_WRITE_ALLOCATE, NULL );
+   sdPT sdP                = sdInit( blockSize, maxAssoc, maxSetsLog, validate );
+
+   traceRecT rec;
+   while( traceRead( traceP, &rec ) ){
+      doTraceCheck( rec.operation, rec.dst, rec.src1, rec.src2 );
+      if( rec.operation != PROC_INST_TYPE2 ) continue;
+      if( l1P && cacheCommunicate( l1P, rec.mem, CMD_DIR_READ ).hit ) continue;
+      sdAccess( sdP, (uaddrT) rec.mem );
+   }
+   traceClose( traceP );
+
+   if( l1P )
+      printf( "Profiling the miss stream of a %d B %d-way L1\n", l1Size, l1Assoc );
+   sdPrintTable( sdP, stdout );
+
+   int mismatches          = 0;
+   if( validate ){
+      printf( "VALIDATION\n" );
+      int setsLogs[3]      = { 0, maxSetsLog / 2, maxSetsLog };
+      int assocs[3]        = { 1, 4, maxAssoc };
+      for( int i = 0; i < 3; i++ ){
+         for( int j = 0; j < 3; j++ ){
+            if( assocs[j] > maxAssoc ) continue;
+            mismatches    += sdValidate( sdP, ( blockSize * assocs[j] ) << setsLogs[i], assocs[j], stdout );
+         }
+      }
+   }
+
+   cacheDestroy( l1P );
+   sdDestroy( sdP );
+   return ( mismatches > 0 ) ? 1 : 0;
+}
+
 int main( int argc, char** argv )
 {
+   if( argc >= 2 && strcmp( argv[1], "--sweep" ) == 0 ) return mainSweep( argc, argv );
+   if( argc >= 2 && strcmp( argv[1], "--stackdist" ) == 0 ) return mainStackDist( argc, argv );
+   if( argc < 9 ) usage();
+
    char traceFile[128];
    int s                   = atoi( argv[1] );
    int n                   = atoi( argv[2] );
@@ -56,11 +198,87 @@ int main( int argc, char** argv )
    int l2Assoc             = atoi( argv[7] );
    sprintf( traceFile, "%s", argv[8] );
 
-   FILE* fp                = fopen( traceFile, "r" ); 
-   ASSERT(!fp, "Unable to read file: %s\n", traceFile);
+   boolean async           = FALSE;
+   boolean stats           = FALSE;
+   boolean event           = FALSE;
+   boolean cacheOnly       = FALSE;
+   int numThreads          = 1;
+   rlogFormatT logFormat   = RLOG_FMT_TEXT;
+   char* logFile           = NULL;
+   boolean logAsync        = FALSE;
+   for( int argIndex = 9; argIndex < argc; argIndex++ ){
+      char* argP           = argv[argIndex];
+      if(      strcmp( argP, "--async" ) == 0 ) async = TRUE;
+      else if( strcmp( argP, "--stats" ) == 0 ) stats = TRUE;
+      else if( strcmp( argP, "--event" ) == 0 ) event = TRUE;
+      else if( strcmp( argP, "--cache-only" ) == 0 ) cacheOnly = TRUE;
+      else if( strncmp( argP, "--threads=", 10 ) == 0 ) numThreads = atoi( argP + 10 );
+      else if( strcmp( argP, "--retire-log=text" ) == 0 ) logFormat = RLOG_FMT_TEXT;
+      else if( strcmp( argP, "--retire-log=bin"  ) == 0 ) logFormat = RLOG_FMT_BIN;
+      else if( strcmp( argP, "--retire-log=none" ) == 0 ) logFormat = RLOG_FMT_NONE;
+      else if( strcmp( argP, "--retire-log-async" ) == 0 ) logAsync = TRUE;
+      else if( strncmp( argP, "--retire-log-file=", 18 ) == 0 ) logFile = argP + 18;
+      else usage();
+   }
+   // Binary records would end up in the middle of the text summary
+   ASSERT( logFormat == RLOG_FMT_BIN && !logFile, "--retire-log=bin needs --retire-log-file\n" );
+
+   // Prefer the memory mapped reader, fall back to stdio if the trace can not be mapped
+   FILE* fp                = NULL;
+   tracePT traceP          = traceOpen( traceFile );
+   if( !traceP ){
+      fp                   = fopen( traceFile, "r" ); 
+      ASSERT(!fp, "Unable to read file: %s\n", traceFile);
+   }
+   // Background decoding needs a trace reader, stdio fallback stays synchronous
+   if( async && traceP )
+      traceAsyncStart( traceP );
+
+   dsPT dsP                = dynamicSchedulerInit( "DS", fp, traceP, s, n, ( traceP ) ? doTraceMapped : doTrace,
+                                                   blockSize, l1Size, l1Assoc, l2Size, l2Assoc );
+   dsP->eventDriven        = event;
+
+   // No pipeline, no retire log and no timing
+   if( cacheOnly ){
+      if( numThreads > 1 && dsP->l1P ){
+         // Trace is decoded up front, the sets are then played in parallel
+         replayPT replayP  = replayInit( dsP->l1P, dsP->l2P, numThreads );
+         addrT pc, mem;
+         int operation, dst, src1, src2;
+         while( dsP->fetchFP( dsP, &pc, &operation, &dst, &src1, &src2, &mem ) ){
+            dsP->numInstructions++;
+            if( operation == PROC_INST_TYPE2 )
+               replayAdd( replayP, mem );
+         }
+         replayRun( replayP );
+         replayDestroy( replayP );
+      } else{
+         dsCacheReplay( dsP );
+      }
+      traceClose( traceP );
+      cachePrintContents( dsP->l1P );
+      cachePrintContents( dsP->l2P );
+      printf("RESULTS\n");
+      printf(" number of instructions = %" PRIcount "\n", dsP->numInstructions);
+      DS_PROF_PRINT( dsP, stderr );
+      dsDestroy( dsP );
+      return 0;
+   }
+
+   FILE* logFp             = stdout;
+   if( logFile && logFormat != RLOG_FMT_NONE ){
+      logFp                = fopen( logFile, "wb" );
+      ASSERT(!logFp, "Unable to create file: %s\n", logFile);
+   }
+   dsP->rlogP              = rlogOpen( logFp, logFormat, logAsync );
 
-   dsPT dsP                = dynamicSchedulerInit( "DS", fp, s, n, doTrace, blockSize, l1Size, l1Assoc, l2Size, l2Assoc );
    while( !dsProcess( dsP ) );
+   traceClose( traceP );
+
+   // Log has to be out before anything else goes to stdout
+   rlogClose( dsP->rlogP );
+   if( logFp != stdout )
+      fclose( logFp );
 
    cachePrintContents( dsP->l1P );
    cachePrintContents( dsP->l2P );
@@ -71,10 +289,20 @@ int main( int argc, char** argv )
    printf(" dispatch queue size (2*N) = %d\n", 2*dsP->n);
    printf(" schedule queue size (S)   = %d\n", dsP->s);
    printf("RESULTS\n");
-   printf(" number of instructions = %d\n", numInstructions);
+   printf(" number of instructions = %" PRIcount "\n", dsP->numInstructions);
    // Cycle - 1 as it stands one ahead
-   int cycles              = dsP->cycle - 1;
-   printf(" number of cycles       = %d\n", cycles);
-   printf(" IPC                    = %0.2f\n", (double)numInstructions / (double)(cycles));
+   countT cycles           = dsP->cycle - 1;
+   printf(" number of cycles       = %" PRIcount "\n", cycles);
+   printf(" IPC                    = %0.2f\n", (double)dsP->numInstructions / (double)(cycles));
+
+   if( stats ){
+      poolPrintStats( dsP->instPoolP, stderr );
+      fprintf( stderr, "DS STATS\n" );
+      fprintf( stderr, " skipped idle cycles    = %" PRIcount "\n", dsP->skippedCycles );
+      fprintf( stderr, " heap allocations       = %ld\n", heapCalls() );
+      if( dsP->l1P ) fprintf( stderr, " L1 tag match kernel    = %s\n", dsP->l1P->matchName );
+      if( dsP->l2P ) fprintf( stderr, " L2 tag match kernel    = %s\n", dsP->l2P->matchName );
+   }
+   DS_PROF_PRINT( dsP, stderr );
 
 }
@@ -0,0 +1,99 @@
+/*H**********************************************************************
+* FILENAME    :       pool.c 
+* DESCRIPTION :       Consists fixed size object pool related operations
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "pool.h"
+
+// Allocates and inits all internal variables
+// First slab is allocated right away so that a pool sized for the
+// working set never allocates again
+poolPT  poolInit( char* name, int objSize, int chunkObjs )
+{
+   // Calloc the mem to reset all vars to 0
+   poolPT poolP                      = (poolPT) calloc( 1, sizeof(poolT) );
+   ASSERT( !poolP, "Unable to create pool" );
+
+   snprintf( poolP->name, sizeof(poolP->name), "%s", name );
+   // Free objects hold the free list link
+   if( objSize < (int) sizeof(void*) )
+      objSize                        = sizeof(void*);
+   // Keep every object pointer aligned
+   poolP->objSize                    = ( objSize + sizeof(void*) - 1 ) & ~( sizeof(void*) - 1 );
+   poolP->chunkObjs                  = ( chunkObjs > 0 ) ? chunkObjs : 1;
+   poolP->freeP                      = NULL;
+
+   poolAddChunk( poolP );
+   return poolP;
+}
+
+// Releases every slab, objects still in use go with them
+void poolDestroy( poolPT poolP )
+{
+   if( !poolP ) return;
+   for( int i = 0; i < poolP->numChunks; i++ )
+      free( poolP->chunkP[i] );
+   free( poolP->chunkP );
+   free( poolP );
+}
+
+// Adds a slab and threads all of its objects on the free list
+void poolAddChunk( poolPT poolP )
+{
+   if( poolP->numChunks == poolP->chunkCap ){
+      poolP->chunkCap                = ( poolP->chunkCap > 0 ) ? 2 * poolP->chunkCap : 4;
+      poolP->chunkP                  = (void**) realloc( poolP->chunkP, poolP->chunkCap * sizeof(void*) );
+      ASSERT( !poolP->chunkP, "Unable to grow pool %s", poolP->name );
+   }
+
+   char* chunkP                      = (char*) malloc( (size_t) poolP->objSize * poolP->chunkObjs );
+   ASSERT( !chunkP, "Unable to grow pool %s", poolP->name );
+   poolP->chunkP[ poolP->numChunks++ ] = chunkP;
+
+   // Thread back to front so that objects are handed out in address order
+   for( int i = poolP->chunkObjs - 1; i >= 0; i-- ){
+      void* objP                     = chunkP + (size_t) i * poolP->objSize;
+      *(void**) objP                 = poolP->freeP;
+      poolP->freeP                   = objP;
+   }
+}
+
+// Returns a zeroed object, same as calloc would
+void* poolAlloc( poolPT poolP )
+{
+   if( poolP->freeP == NULL )
+      poolAddChunk( poolP );
+
+   void* objP                        = poolP->freeP;
+   poolP->freeP                      = *(void**) objP;
+   memset( objP, 0, poolP->objSize );
+
+   poolP->numAllocs++;
+   if( ++poolP->inUse > poolP->highWater )
+      poolP->highWater               = poolP->inUse;
+   return objP;
+}
+
+void poolFree( poolPT poolP, void* objP )
+{
+   *(void**) objP                    = poolP->freeP;
+   poolP->freeP                      = objP;
+   poolP->inUse--;
+}
+
+void poolPrintStats( poolPT poolP, FILE* fp )
+{
+   if( !poolP ) return;
+   fprintf( fp, "%s POOL STATS\n", poolP->name );
+   fprintf( fp, " object size            = %d\n"  , poolP->objSize );
+   fprintf( fp, " objects per slab       = %d\n"  , poolP->chunkObjs );
+   fprintf( fp, " slabs                  = %d\n"  , poolP->numChunks );
+   fprintf( fp, " allocations            = %lld\n", poolP->numAllocs );
+   fprintf( fp, " in use                 = %d\n"  , poolP->inUse );
+   fprintf( fp, " high water mark        = %d\n"  , poolP->highWater );
+}
@@ -0,0 +1,49 @@
+/*H**********************************************************************
+* FILENAME    :       pool.h
+* DESCRIPTION :       Contains structures and prototypes for a fixed
+*                     size object pool
+* NOTES       :       -NA-
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include "all.h"
+
+// Pointer translations
+typedef  struct  _poolT                 *poolPT;
+
+// Fixed size object pool.
+// Objects are carved out of slabs of chunkObjs objects each. Freed objects
+// go on an intrusive LIFO free list (the link lives in the object itself)
+// and are handed out again before a new slab is touched
+typedef struct _poolT{
+   // Placeholder for name
+   char                name[128];
+   int                 objSize;
+   int                 chunkObjs;
+
+   void*               freeP;
+   void**              chunkP;
+   int                 numChunks;
+   int                 chunkCap;
+
+   // Statistics
+   int                 inUse;
+   int                 highWater;
+   long long           numAllocs;
+}poolT;
+
+poolPT     poolInit( char* name, int objSize, int chunkObjs );
+void       poolDestroy( poolPT poolP );
+void       poolAddChunk( poolPT poolP );
+void*      poolAlloc( poolPT poolP );
+void       poolFree( poolPT poolP, void* objP );
+void       poolPrintStats( poolPT poolP, FILE* fp );
+#endif
@@ -0,0 +1,211 @@
+/*H**********************************************************************
+* FILENAME    :       replay.c
+* DESCRIPTION :       Consists set sharded cache replay related operations
+* NOTES       :       Every set sees its accesses in stream order, so the
+*                     merged caches are bit identical to replaying the
+*                     stream through cacheCommunicate on one thread
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "replay.h"
+
+// Allocates and inits all internal variables
+// Results are merged into l1P/l2P, which must be freshly initialized.
+// l2P may be NULL
+replayPT  replayInit( cachePT l1P, cachePT l2P, int numThreads )
+{
+   ASSERT( !l1P, "Cache replay needs an L1" );
+   ASSERT( numThreads <= 0, "Cache replay needs at least one thread" );
+   // LRFU ages blocks by the cache wide access count and a victim cache is
+   // shared by all sets. Neither splits by set
+   ASSERT( l1P->repPolicy == POLICY_REP_LRFU || ( l2P && l2P->repPolicy == POLICY_REP_LRFU ),
+           "Sharded replay does not support LRFU" );
+   ASSERT( l1P->victimP || ( l2P && l2P->victimP ), "Sharded replay does not support victim caches" );
+
+   // Calloc the mem to reset all vars to 0
+   replayPT replayP                  = (replayPT) calloc( 1, sizeof(replayT) );
+   ASSERT( !replayP, "Unable to create cache replay" );
+   replayP->l1P                      = l1P;
+   replayP->l2P                      = l2P;
+   replayP->numThreads               = numThreads;
+   return replayP;
+}
+
+void replayAdd( replayPT replayP, addrT address )
+{
+   if( replayP->numAddr == replayP->addrCap ){
+      ASSERT( replayP->addrCap >= 0x7FFFFFFFu, "Cache replay stream is limited to 2^31 reads" );
+      replayP->addrCap               = ( replayP->addrCap > 0 ) ? 2 * replayP->addrCap : 65536;
+      replayP->addrP                 = (addrT*) realloc( replayP->addrP, replayP->addrCap * sizeof(addrT) );
+      ASSERT( !replayP->addrP, "Unable to grow cache replay stream" );
+   }
+   replayP->addrP[ replayP->numAddr++ ] = address;
+}
+
+// Replays everything added so far and merges the shards into l1P/l2P
+void replayRun( replayPT replayP )
+{
+   int numThreads                    = replayP->numThreads;
+
+   // A shard with no sets would just idle
+   replayP->l1Shards                 = ( replayP->l1P->nSets < numThreads ) ? replayP->l1P->nSets : numThreads;
+   replayP->l2Shards                 = 0;
+   if( replayP->l2P )
+      replayP->l2Shards              = ( replayP->l2P->nSets < numThreads ) ? replayP->l2P->nSets : numThreads;
+
+   replayP->missP                    = (unsigned char*) calloc( replayP->numAddr + 1, 1 );
+   replayP->bucketP                  = (replayBucketT*) calloc( numThreads * numThreads, sizeof(replayBucketT) );
+   replayP->l1ShardP                 = (cachePT*) calloc( numThreads, sizeof(cachePT) );
+   replayP->l2ShardP                 = (cachePT*) calloc( numThreads, sizeof(cachePT) );
+   replayWorkerT* workerP            = (replayWorkerT*) calloc( numThreads, sizeof(replayWorkerT) );
+   pthread_t* threadP                = (pthread_t*) calloc( numThreads, sizeof(pthread_t) );
+   ASSERT( !replayP->missP || !replayP->bucketP || !replayP->l1ShardP || !replayP->l2ShardP || !workerP || !threadP,
+           "Unable to allocate cache replay" );
+
+   // Private copies, so threads share nothing but the stream and missP
+   for( int shard = 0; shard < replayP->l1Shards; shard++ )
+      replayP->l1ShardP[shard]       = cacheClone( replayP->l1P );
+   for( int shard = 0; shard < replayP->l2Shards; shard++ )
+      replayP->l2ShardP[shard]       = cacheClone( replayP->l2P );
+
+   pthread_mutex_init( &replayP->lock, NULL );
+   pthread_cond_init( &replayP->cond, NULL );
+   // The calling thread is worker 0
+   for( int i = 0; i < numThreads; i++ ){
+      workerP[i].replayP             = replayP;
+      workerP[i].id                  = i;
+   }
+   for( int i = 1; i < numThreads; i++ )
+      ASSERT( pthread_create( &threadP[i], NULL, replayWorker, &workerP[i] ) != 0, "Unable to start replay worker" );
+   replayWorker( &workerP[0] );
+   for( int i = 1; i < numThreads; i++ )
+      pthread_join( threadP[i], NULL );
+   pthread_mutex_destroy( &replayP->lock );
+   pthread_cond_destroy( &replayP->cond );
+
+   for( int shard = 0; shard < replayP->l1Shards; shard++ ){
+      cacheMergeShard( replayP->l1P, replayP->l1ShardP[shard], shard, replayP->l1Shards );
+      cacheDestroy( replayP->l1ShardP[shard] );
+   }
+   for( int shard = 0; shard < replayP->l2Shards; shard++ ){
+      cacheMergeShard( replayP->l2P, replayP->l2ShardP[shard], shard, replayP->l2Shards );
+      cacheDestroy( replayP->l2ShardP[shard] );
+   }
+
+   free( replayP->missP );
+   free( replayP->bucketP );
+   free( replayP->l1ShardP );
+   free( replayP->l2ShardP );
+   free( workerP );
+   free( threadP );
+   replayP->missP                    = NULL;
+   replayP->bucketP                  = NULL;
+   replayP->l1ShardP                 = NULL;
+   replayP->l2ShardP                 = NULL;
+}
+
+// One thread: bucket a chunk, play a shard, then the same for L2
+void* replayWorker( void* dataP )
+{
+   replayWorkerPT workerP            = (replayWorkerPT) dataP;
+   replayPT replayP                  = workerP->replayP;
+   int id                            = workerP->id;
+
+   replayBucket( replayP, id, replayP->l1P, replayP->l1Shards, NULL );
+   replayBarrier( replayP );
+   if( id < replayP->l1Shards )
+      replayShard( replayP, id, replayP->l1ShardP[id], replayP->missP );
+   replayBarrier( replayP );
+
+   if( replayP->l2P ){
+      replayBucket( replayP, id, replayP->l2P, replayP->l2Shards, replayP->missP );
+      replayBarrier( replayP );
+      if( id < replayP->l2Shards )
+         replayShard( replayP, id, replayP->l2ShardP[id], NULL );
+   }
+
+   // Other shards may still be reading this chunk's buckets
+   replayBarrier( replayP );
+   for( int shard = 0; shard < replayP->numThreads; shard++ )
+      free( replayP->bucketP[ id * replayP->numThreads + shard ].posP );
+   return NULL;
+}
+
+// Waits until all numThreads workers got here
+void replayBarrier( replayPT replayP )
+{
+   pthread_mutex_lock( &replayP->lock );
+   int phase                         = replayP->phase;
+   if( ++replayP->numWaiting == replayP->numThreads ){
+      replayP->numWaiting            = 0;
+      replayP->phase++;
+      pthread_cond_broadcast( &replayP->cond );
+   } else{
+      while( replayP->phase == phase )
+         pthread_cond_wait( &replayP->cond, &replayP->lock );
+   }
+   pthread_mutex_unlock( &replayP->lock );
+}
+
+// Splits chunk's positions by set index % numShards of cacheP. With a
+// filter only flagged positions are taken. Chunk buckets are owned by the
+// thread of the same id, earlier buckets of the chunk are freed first
+void replayBucket( replayPT replayP, int chunk, cachePT cacheP, int numShards, unsigned char* filterP )
+{
+   int numThreads                    = replayP->numThreads;
+   unsigned int begin                = (unsigned int) ( (unsigned long long) replayP->numAddr * chunk / numThreads );
+   unsigned int end                  = (unsigned int) ( (unsigned long long) replayP->numAddr * ( chunk + 1 ) / numThreads );
+   replayBucketT* bucketP            = replayP->bucketP + chunk * numThreads;
+
+   // Count, size, fill
+   addrT tag;
+   int index, offset;
+   for( int shard = 0; shard < numThreads; shard++ ){
+      free( bucketP[shard].posP );
+      bucketP[shard].posP            = NULL;
+      bucketP[shard].numPos          = 0;
+   }
+   for( unsigned int pos = begin; pos < end; pos++ ){
+      if( filterP && !filterP[pos] ) continue;
+      cacheDecodeAddress( cacheP, replayP->addrP[pos], &tag, &index, &offset );
+      bucketP[ index % numShards ].numPos++;
+   }
+   for( int shard = 0; shard < numShards; shard++ ){
+      bucketP[shard].posP            = (unsigned int*) malloc( ( bucketP[shard].numPos + 1 ) * sizeof(unsigned int) );
+      ASSERT( !bucketP[shard].posP, "Unable to allocate replay bucket" );
+      bucketP[shard].numPos          = 0;
+   }
+   for( unsigned int pos = begin; pos < end; pos++ ){
+      if( filterP && !filterP[pos] ) continue;
+      cacheDecodeAddress( cacheP, replayP->addrP[pos], &tag, &index, &offset );
+      replayBucketT* toP             = &bucketP[ index % numShards ];
+      toP->posP[ toP->numPos++ ]     = pos;
+   }
+}
+
+// Plays one shard's accesses in stream order. Misses are flagged in missP
+// when given, every position belongs to exactly one shard so no two
+// threads write the same byte
+void replayShard( replayPT replayP, int shard, cachePT cacheP, unsigned char* missP )
+{
+   int numThreads                    = replayP->numThreads;
+   for( int chunk = 0; chunk < numThreads; chunk++ ){
+      replayBucketT* bucketP         = &replayP->bucketP[ chunk * numThreads + shard ];
+      for( unsigned int i = 0; i < bucketP->numPos; i++ ){
+         unsigned int pos            = bucketP->posP[i];
+         cacheCommT comm             = cacheCommunicate( cacheP, replayP->addrP[pos], CMD_DIR_READ );
+         if( missP && !comm.hit )
+            missP[pos]               = 1;
+      }
+   }
+}
+
+void replayDestroy( replayPT replayP )
+{
+   free( replayP->addrP );
+   free( replayP );
+}
@@ -0,0 +1,74 @@
+/*H**********************************************************************
+* FILENAME    :       replay.h
+* DESCRIPTION :       Contains structures and prototypes for replaying a
+*                     memory read stream through L1/L2 on many threads
+* NOTES       :       Sets of a cache never interact, so each thread owns
+*                     the sets with index % threads == its id
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include "all.h"
+#include "cache.h"
+#include <pthread.h>
+
+// Pointer translations
+typedef  struct  _replayT             *replayPT;
+typedef  struct  _replayWorkerT       *replayWorkerPT;
+
+// Positions (into the address stream) of one chunk that belong to one
+// shard, in stream order
+typedef struct _replayBucketT{
+   unsigned int*       posP;
+   unsigned int        numPos;
+}replayBucketT;
+
+typedef struct _replayWorkerT{
+   replayPT            replayP;
+   int                 id;
+}replayWorkerT;
+
+// Replay state.
+// The stream is cut into numThreads chunks. Thread c splits chunk c into
+// one bucket per shard, shard s then walks buckets [0][s], [1][s] ...
+// which is exactly its own accesses in stream order. L1 misses are
+// flagged per position and bucketed again by L2 index the same way
+typedef struct _replayT{
+   cachePT             l1P;
+   cachePT             l2P;
+   int                 numThreads;
+
+   addrT*              addrP;
+   unsigned int        numAddr;
+   unsigned int        addrCap;
+   unsigned char*      missP;
+
+   // numThreads x numThreads, [chunk * numThreads + shard]
+   replayBucketT*      bucketP;
+   cachePT*            l1ShardP;
+   cachePT*            l2ShardP;
+   int                 l1Shards;
+   int                 l2Shards;
+   // Phase barrier
+   pthread_mutex_t     lock;
+   pthread_cond_t      cond;
+   int                 numWaiting;
+   int                 phase;
+}replayT;
+
+replayPT   replayInit( cachePT l1P, cachePT l2P, int numThreads );
+void       replayAdd( replayPT replayP, addrT address );
+void       replayRun( replayPT replayP );
+void*      replayWorker( void* dataP );
+void       replayBarrier( replayPT replayP );
+void       replayBucket( replayPT replayP, int chunk, cachePT cacheP, int numShards, unsigned char* filterP );
+void       replayShard( replayPT replayP, int shard, cachePT cacheP, unsigned char* missP );
+void       replayDestroy( replayPT replayP );
+#endif
@@ -0,0 +1,300 @@
+/*H**********************************************************************
+* FILENAME    :       rlog.c
+* DESCRIPTION :       Consists retire log writer related operations
+* NOTES       :       Text lines are byte identical to the printf the
+*                     simulator used to do in fakeRetire
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "rlog.h"
+
+// Allocates and inits all internal variables
+// Returns NULL when logging is disabled so callers only test the pointer
+rlogPT  rlogOpen( FILE* fp, rlogFormatT format, boolean async )
+{
+   if( format == RLOG_FMT_NONE ) return NULL;
+
+   // Calloc the mem to reset all vars to 0
+   rlogPT rlogP                      = (rlogPT) calloc( 1, sizeof(rlogT) );
+   ASSERT( !rlogP, "Unable to create retire log" );
+
+   rlogP->fp                         = fp;
+   rlogP->format                     = format;
+   rlogP->async                      = async;
+   rlogP->bufP[0]                    = (char*) malloc( RLOG_BUF_SIZE );
+   rlogP->bufP[1]                    = (char*) malloc( RLOG_BUF_SIZE );
+   ASSERT( !rlogP->bufP[0] || !rlogP->bufP[1], "Unable to allocate retire log buffers" );
+
+   // Record count is patched in by rlogClose
+   if( format == RLOG_FMT_BIN )
+      rlogWriteHeader( fp, 0 );
+
+   if( async ){
+      pthread_mutex_init( &rlogP->lock, NULL );
+      pthread_cond_init( &rlogP->cond, NULL );
+      int status                     = pthread_create( &rlogP->thread, NULL, rlogWriter, rlogP );
+      ASSERT( status != 0, "Unable to start retire log writer thread" );
+   }
+   return rlogP;
+}
+
+// Formats one record into the fill buffer
+void rlogWrite( rlogPT rlogP, rlogRecPT recP )
+{
+   if( rlogP->used + RLOG_MAX_LINE > RLOG_BUF_SIZE )
+      rlogHandOff( rlogP );
+
+   char* p          = rlogP->bufP[ rlogP->fill ] + rlogP->used;
+   if( rlogP->format == RLOG_FMT_TEXT )
+      rlogP->used  += rlogFormatText( p, recP );
+   else
+      rlogP->used  += rlogFormatBin( p, recP );
+   rlogP->numRecords++;
+}
+
+// Gets the fill buffer out. Synchronous mode writes it in place, async mode
+// waits for the writer to finish the previous buffer and swaps
+void rlogHandOff( rlogPT rlogP )
+{
+   if( rlogP->used == 0 ) return;
+
+   if( !rlogP->async ){
+      fwrite( rlogP->bufP[ rlogP->fill ], 1, rlogP->used, rlogP->fp );
+      rlogP->used    = 0;
+      return;
+   }
+
+   pthread_mutex_lock( &rlogP->lock );
+   while( rlogP->pending > 0 )
+      pthread_cond_wait( &rlogP->cond, &rlogP->lock );
+   rlogP->pending    = rlogP->used;
+   rlogP->fill      ^= 1;
+   rlogP->used       = 0;
+   pthread_cond_broadcast( &rlogP->cond );
+   pthread_mutex_unlock( &rlogP->lock );
+}
+
+// Writes out everything logged so far. Anything printed to the same
+// stream afterwards lands behind the log
+void rlogFlush( rlogPT rlogP )
+{
+   if( !rlogP ) return;
+
+   rlogHandOff( rlogP );
+   if( rlogP->async ){
+      pthread_mutex_lock( &rlogP->lock );
+      while( rlogP->pending > 0 )
+         pthread_cond_wait( &rlogP->cond, &rlogP->lock );
+      pthread_mutex_unlock( &rlogP->lock );
+   }
+   fflush( rlogP->fp );
+}
+
+// Flushes, stops the writer and patches the binary header.
+// The stream itself belongs to the caller
+void rlogClose( rlogPT rlogP )
+{
+   if( !rlogP ) return;
+
+   rlogFlush( rlogP );
+   if( rlogP->async ){
+      pthread_mutex_lock( &rlogP->lock );
+      rlogP->stop    = TRUE;
+      pthread_cond_broadcast( &rlogP->cond );
+      pthread_mutex_unlock( &rlogP->lock );
+      pthread_join( rlogP->thread, NULL );
+      pthread_mutex_destroy( &rlogP->lock );
+      pthread_cond_destroy( &rlogP->cond );
+   }
+
+   // Not fatal for non seekable outputs, header then says 0 == unknown
+   if( rlogP->format == RLOG_FMT_BIN && fseek( rlogP->fp, 0, SEEK_SET ) == 0 ){
+      rlogWriteHeader( rlogP->fp, rlogP->numRecords );
+      fseek( rlogP->fp, 0, SEEK_END );
+   }
+   fflush( rlogP->fp );
+
+   free( rlogP->bufP[0] );
+   free( rlogP->bufP[1] );
+   free( rlogP );
+}
+
+// Background writer. Owns bufP[!fill] while pending is non zero
+void* rlogWriter( void* dataP )
+{
+   rlogPT rlogP     = (rlogPT) dataP;
+
+   pthread_mutex_lock( &rlogP->lock );
+   while( TRUE ){
+      while( rlogP->pending == 0 && !rlogP->stop )
+         pthread_cond_wait( &rlogP->cond, &rlogP->lock );
+      if( rlogP->pending == 0 ) break;
+
+      char* bufP    = rlogP->bufP[ rlogP->fill ^ 1 ];
+      int   numBytes= rlogP->pending;
+      pthread_mutex_unlock( &rlogP->lock );
+      fwrite( bufP, 1, numBytes, rlogP->fp );
+      pthread_mutex_lock( &rlogP->lock );
+
+      rlogP->pending= 0;
+      pthread_cond_broadcast( &rlogP->cond );
+   }
+   pthread_mutex_unlock( &rlogP->lock );
+   return NULL;
+}
+
+// Decimal without going through printf, returns the end of the digits
+char* rlogPutInt( char* p, countT value )
+{
+   char digits[21];
+   int  numDigits   = 0;
+   ucountT u        = (ucountT) value;
+   if( value < 0 ){
+      *p++          = '-';
+      u             = 0u - u;
+   }
+   do{
+      digits[ numDigits++ ] = '0' + u % 10;
+      u            /= 10;
+   }while( u != 0 );
+
+   while( numDigits > 0 )
+      *p++          = digits[ --numDigits ];
+   return p;
+}
+
+char* rlogPutStr( char* p, const char* strP )
+{
+   while( *strP )
+      *p++          = *strP++;
+   return p;
+}
+
+// Little-endian store
+char* rlogPutU( char* p, unsigned long long value, int numBytes )
+{
+   for( int i = 0; i < numBytes; i++ )
+      *p++          = (char) ( value >> ( 8 * i ) );
+   return p;
+}
+
+// Little-endian load
+unsigned long long rlogGetU( unsigned char* p, int numBytes )
+{
+   unsigned long long value = 0;
+   for( int i = numBytes - 1; i >= 0; i-- )
+      value         = ( value << 8 ) | p[i];
+   return value;
+}
+
+// "%d fu{%d} src{%d,%d} dst{%d} IF{%d,%d} ID{%d,%d} IS{%d,%d} EX{%d,%d} WB{%d,%d}\n"
+int rlogFormatText( char* p, rlogRecPT recP )
+{
+   char* startP     = p;
+   p                = rlogPutInt( p, recP->sequenceNum );
+   p                = rlogPutStr( p, " fu{" );
+   p                = rlogPutInt( p, recP->type );
+   p                = rlogPutStr( p, "} src{" );
+   p                = rlogPutInt( p, recP->src1 );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->src2 );
+   p                = rlogPutStr( p, "} dst{" );
+   p                = rlogPutInt( p, recP->dst );
+   p                = rlogPutStr( p, "} IF{" );
+   p                = rlogPutInt( p, recP->ifStart );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->ifDuration );
+   p                = rlogPutStr( p, "} ID{" );
+   p                = rlogPutInt( p, recP->idStart );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->idDuration );
+   p                = rlogPutStr( p, "} IS{" );
+   p                = rlogPutInt( p, recP->isStart );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->isDuration );
+   p                = rlogPutStr( p, "} EX{" );
+   p                = rlogPutInt( p, recP->exStart );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->exDuration );
+   p                = rlogPutStr( p, "} WB{" );
+   p                = rlogPutInt( p, recP->wbStart );
+   *p++             = ',';
+   p                = rlogPutInt( p, recP->wbDuration );
+   p                = rlogPutStr( p, "}\n" );
+   return p - startP;
+}
+
+int rlogFormatBin( char* p, rlogRecPT recP )
+{
+   char* startP     = p;
+   p                = rlogPutU( p, recP->sequenceNum, RLOG_BIN_COUNT_SIZE );
+   p                = rlogPutU( p, recP->type, 1 );
+   p                = rlogPutU( p, recP->src1, 1 );
+   p                = rlogPutU( p, recP->src2, 1 );
+   p                = rlogPutU( p, recP->dst, 1 );
+   p                = rlogPutU( p, recP->ifStart, RLOG_BIN_COUNT_SIZE );
+   p                = rlogPutU( p, recP->ifDuration, 4 );
+   p                = rlogPutU( p, recP->idDuration, 4 );
+   p                = rlogPutU( p, recP->isDuration, 4 );
+   p                = rlogPutU( p, recP->exDuration, 4 );
+   p                = rlogPutU( p, recP->wbDuration, 4 );
+   return p - startP;
+}
+
+void rlogWriteHeader( FILE* fp, unsigned long long numRecords )
+{
+   char  header[ RLOG_BIN_HEADER_SIZE ];
+   char* p          = rlogPutStr( header, RLOG_BIN_MAGIC );
+   p                = rlogPutU( p, RLOG_BIN_VERSION, 2 );
+   p                = rlogPutU( p, RLOG_BIN_REC_SIZE, 2 );
+   p                = rlogPutU( p, (unsigned int) numRecords, 4 );
+   p                = rlogPutU( p, (unsigned int) ( numRecords >> 32 ), 4 );
+   fwrite( header, 1, RLOG_BIN_HEADER_SIZE, fp );
+}
+
+// Reader side, used by tools. Fails on anything but a DSRL v1 stream
+// with this build's record size
+boolean rlogReadHeader( FILE* fp, unsigned long long* numRecordsP )
+{
+   unsigned char header[ RLOG_BIN_HEADER_SIZE ];
+   if( fread( header, 1, RLOG_BIN_HEADER_SIZE, fp ) != RLOG_BIN_HEADER_SIZE ) return FALSE;
+   if( memcmp( header, RLOG_BIN_MAGIC, 4 ) != 0 ) return FALSE;
+   if( ( header[4] | header[5] << 8 ) != RLOG_BIN_VERSION ) return FALSE;
+   if( ( header[6] | header[7] << 8 ) != RLOG_BIN_REC_SIZE ) return FALSE;
+
+   *numRecordsP     = 0;
+   for( int i = 7; i >= 0; i-- )
+      *numRecordsP  = ( *numRecordsP << 8 ) | header[ 8 + i ];
+   return TRUE;
+}
+
+boolean rlogReadBin( FILE* fp, rlogRecPT recP )
+{
+   unsigned char rec[ RLOG_BIN_REC_SIZE ];
+   if( fread( rec, 1, RLOG_BIN_REC_SIZE, fp ) != RLOG_BIN_REC_SIZE ) return FALSE;
+
+   unsigned char* p     = rec + RLOG_BIN_COUNT_SIZE;
+   recP->sequenceNum    = (countT) rlogGetU( rec, RLOG_BIN_COUNT_SIZE );
+   recP->type           = p[0];
+   recP->src1           = (signed char) p[1];
+   recP->src2           = (signed char) p[2];
+   recP->dst            = (signed char) p[3];
+   recP->ifStart        = (countT) rlogGetU( p + 4, RLOG_BIN_COUNT_SIZE );
+   p                   += 4 + RLOG_BIN_COUNT_SIZE;
+   recP->ifDuration     = (int) rlogGetU( p, 4 );
+   recP->idDuration     = (int) rlogGetU( p + 4, 4 );
+   recP->isDuration     = (int) rlogGetU( p + 8, 4 );
+   recP->exDuration     = (int) rlogGetU( p + 12, 4 );
+   recP->wbDuration     = (int) rlogGetU( p + 16, 4 );
+
+   // Stages are back to back
+   recP->idStart        = recP->ifStart + recP->ifDuration;
+   recP->isStart        = recP->idStart + recP->idDuration;
+   recP->exStart        = recP->isStart + recP->isDuration;
+   recP->wbStart        = recP->exStart + recP->exDuration;
+   return TRUE;
+}
@@ -0,0 +1,105 @@
+/*H**********************************************************************
+* FILENAME    :       rlog.h
+* DESCRIPTION :       Contains structures and prototypes for the retire
+*                     log writer
+* NOTES       :       -NA-
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _RLOG_H
+#define _RLOG_H
+
+#include "all.h"
+#include <pthread.h>
+
+// Pointer translations
+typedef  struct  _rlogT               *rlogPT;
+typedef  struct  _rlogRecT            *rlogRecPT;
+
+// Size of each of the two output buffers
+#define   RLOG_BUF_SIZE                ( 1 << 20 )
+// Longest text line: 15 ints of at most 20 chars plus the decoration
+#define   RLOG_MAX_LINE                512
+
+// Binary retire log layout (all fields little-endian)
+//    header : magic[4] = "DSRL", u16 version, u16 record size, u64 numRecords
+//    record : uS seq, u8 fu, s8 src1, s8 src2, s8 dst, uS IF start,
+//             u32 IF/ID/IS/EX/WB durations
+// S is 32, or 64 in the DS_64 build, the record size tells them apart.
+// Every stage starts the cycle the previous one ends, so only the IF start
+// is stored. numRecords is 0 if the writer could not seek back to fill it in
+#define   RLOG_BIN_MAGIC               "DSRL"
+#define   RLOG_BIN_VERSION             1
+#define   RLOG_BIN_HEADER_SIZE         16
+#define   RLOG_BIN_COUNT_SIZE          ( (int) sizeof(countT) )
+#define   RLOG_BIN_REC_SIZE            ( 24 + 2 * RLOG_BIN_COUNT_SIZE )
+
+// Enum to hold the retire log format
+typedef enum{
+   RLOG_FMT_NONE                            = 0,      /* Log disabled */
+   RLOG_FMT_TEXT                            = 1,      /* Same lines printf used to write */
+   RLOG_FMT_BIN                             = 2,      /* Fixed width records, see above */
+}rlogFormatT;
+
+// One retired instruction
+typedef struct _rlogRecT{
+   countT              sequenceNum;
+   int                 type;
+   int                 src1;
+   int                 src2;
+   int                 dst;
+   countT              ifStart;
+   int                 ifDuration;
+   countT              idStart;
+   int                 idDuration;
+   countT              isStart;
+   int                 isDuration;
+   countT              exStart;
+   int                 exDuration;
+   countT              wbStart;
+   int                 wbDuration;
+}rlogRecT;
+
+// Retire log writer.
+// Records are formatted into bufP[fill]. A full buffer is either written
+// right away or, in async mode, handed to the writer thread while the
+// simulator keeps filling the other one
+typedef struct _rlogT{
+   FILE*               fp;
+   rlogFormatT         format;
+   unsigned long long  numRecords;
+
+   char*               bufP[2];
+   int                 fill;
+   int                 used;
+
+   // Only for asynchronous writing
+   boolean             async;
+   pthread_t           thread;
+   pthread_mutex_t     lock;
+   pthread_cond_t      cond;
+   int                 pending;     // Bytes of bufP[!fill] not written yet
+   boolean             stop;
+}rlogT;
+
+rlogPT     rlogOpen( FILE* fp, rlogFormatT format, boolean async );
+void       rlogWrite( rlogPT rlogP, rlogRecPT recP );
+void       rlogFlush( rlogPT rlogP );
+void       rlogClose( rlogPT rlogP );
+void       rlogHandOff( rlogPT rlogP );
+void*      rlogWriter( void* dataP );
+char*      rlogPutInt( char* p, countT value );
+char*      rlogPutStr( char* p, const char* strP );
+char*      rlogPutU( char* p, unsigned long long value, int numBytes );
+unsigned long long rlogGetU( unsigned char* p, int numBytes );
+int        rlogFormatText( char* p, rlogRecPT recP );
+int        rlogFormatBin( char* p, rlogRecPT recP );
+void       rlogWriteHeader( FILE* fp, unsigned long long numRecords );
+boolean    rlogReadHeader( FILE* fp, unsigned long long* numRecordsP );
+boolean    rlogReadBin( FILE* fp, rlogRecPT recP );
+#endif
@@ -0,0 +1,165 @@
+/*H**********************************************************************
+* FILENAME    :       stackdist.c
+* DESCRIPTION :       Consists LRU stack distance profiling operations
+* NOTES       :       An LRU cache of associativity A hits exactly the
+*                     accesses found in the top A entries of their set's
+*                     LRU stack, so one histogram per set count covers
+*                     every associativity
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "stackdist.h"
+
+// Allocates and inits all internal variables
+// Profiles set counts 1 .. 2^maxSetsLog and associativities 1 .. maxAssoc.
+// keepAddr logs every access for sdValidate, O(trace) memory
+sdPT  sdInit( int blockSize, int maxAssoc, int maxSetsLog, boolean keepAddr )
+{
+   // Calloc the mem to reset all vars to 0
+   sdPT sdP                          = (sdPT) calloc( 1, sizeof(sdT) );
+   ASSERT( !sdP, "Unable to create stack distance profiler" );
+
+   sdP->blockSize                    = blockSize;
+   while( ( 1 << sdP->boSize ) < blockSize )
+      sdP->boSize++;
+   ASSERT( ( 1 << sdP->boSize ) != blockSize, "Block size must be a power of 2: %d\n", blockSize );
+   ASSERT( maxAssoc <= 0 || ( maxAssoc & ( maxAssoc - 1 ) ) != 0, "Max associativity must be a power of 2: %d\n", maxAssoc );
+   ASSERT( maxSetsLog < 0 || maxSetsLog > 24, "Set count log out of range [0, 24]: %d\n", maxSetsLog );
+   sdP->maxAssoc                     = maxAssoc;
+   sdP->maxSetsLog                   = maxSetsLog;
+   sdP->keepAddr                     = keepAddr;
+
+   sdP->levelP                       = (sdLevelPT) calloc( maxSetsLog + 1, sizeof(sdLevelT) );
+   ASSERT( !sdP->levelP, "Unable to create stack distance profiler" );
+   for( int k = 0; k <= maxSetsLog; k++ ){
+      sdLevelPT levelP               = &sdP->levelP[k];
+      levelP->setsLog                = k;
+      levelP->stackP                 = (uaddrT*) calloc( (size_t) maxAssoc << k, sizeof(uaddrT) );
+      levelP->depthP                 = (int*) calloc( (size_t) 1 << k, sizeof(int) );
+      levelP->hist                   = (long long*) calloc( maxAssoc + 1, sizeof(long long) );
+      ASSERT( !levelP->stackP || !levelP->depthP || !levelP->hist, "Unable to allocate %d sets", 1 << k );
+   }
+   return sdP;
+}
+
+// Records one read at every set count
+void sdAccess( sdPT sdP, uaddrT address )
+{
+   uaddrT block                      = address >> sdP->boSize;
+   int maxAssoc                      = sdP->maxAssoc;
+
+   for( int k = 0; k <= sdP->maxSetsLog; k++ ){
+      sdLevelPT levelP               = &sdP->levelP[k];
+      int set                        = block & ( ( 1u << k ) - 1 );
+      uaddrT* stackP                 = levelP->stackP + (size_t) set * maxAssoc;
+      int depth                      = levelP->depthP[set];
+
+      int dist                       = 0;
+      while( dist < depth && stackP[dist] != block )
+         dist++;
+
+      if( dist < depth ){
+         levelP->hist[dist]++;
+      } else{
+         // Not within maxAssoc: a miss for every profiled associativity.
+         // Deepest block falls off when the stack is full
+         levelP->hist[maxAssoc]++;
+         if( depth < maxAssoc )
+            levelP->depthP[set]      = ++depth;
+         dist                        = depth - 1;
+      }
+
+      // Move to MRU
+      memmove( stackP + 1, stackP, dist * sizeof(uaddrT) );
+      stackP[0]                      = block;
+   }
+
+   if( sdP->keepAddr ){
+      if( sdP->numAddr == sdP->addrCap ){
+         sdP->addrCap                = ( sdP->addrCap > 0 ) ? 2 * sdP->addrCap : 65536;
+         sdP->addrP                  = (uaddrT*) realloc( sdP->addrP, sdP->addrCap * sizeof(uaddrT) );
+         ASSERT( !sdP->addrP, "Unable to grow stack distance address log" );
+      }
+      sdP->addrP[ sdP->numAddr++ ]   = address;
+   }
+   sdP->numAccess++;
+}
+
+// Misses of an LRU cache with 2^setsLog sets of assoc ways
+long long sdMisses( sdPT sdP, int setsLog, int assoc )
+{
+   sdLevelPT levelP                  = &sdP->levelP[ setsLog ];
+   long long misses                  = 0;
+   for( int dist = assoc; dist <= sdP->maxAssoc; dist++ )
+      misses                        += levelP->hist[dist];
+   return misses;
+}
+
+// Miss counts, one row per cache size, one column per associativity.
+// "-" where the size/assoc pair needs more sets than were profiled
+void sdPrintTable( sdPT sdP, FILE* fp )
+{
+   fprintf( fp, "STACK DISTANCE MISSES (block size %d, %lld reads)\n", sdP->blockSize, sdP->numAccess );
+   fprintf( fp, "%10s", "SIZE" );
+   for( int assoc = 1; assoc <= sdP->maxAssoc; assoc <<= 1 )
+      fprintf( fp, " %9d", assoc );
+   fprintf( fp, "\n" );
+
+   int maxSizeLog                    = sdP->boSize + sdP->maxSetsLog;
+   for( int assoc = 2; assoc <= sdP->maxAssoc; assoc <<= 1 )
+      maxSizeLog++;
+
+   for( int sizeLog = sdP->boSize; sizeLog <= maxSizeLog; sizeLog++ ){
+      fprintf( fp, "%10lld", 1LL << sizeLog );
+      for( int assocLog = 0; ( 1 << assocLog ) <= sdP->maxAssoc; assocLog++ ){
+         int setsLog                 = sizeLog - sdP->boSize - assocLog;
+         if( setsLog < 0 || setsLog > sdP->maxSetsLog )
+            fprintf( fp, " %9s", "-" );
+         else
+            fprintf( fp, " %9lld", sdMisses( sdP, setsLog, 1 << assocLog ) );
+      }
+      fprintf( fp, "\n" );
+   }
+}
+
+// Replays the profiled stream through the real cache model and compares.
+// Returns 1 on a mismatch
+int sdValidate( sdPT sdP, int size, int assoc, FILE* fp )
+{
+   int sets                          = size / ( assoc * sdP->blockSize );
+   int setsLog                       = 0;
+   while( ( 1 << setsLog ) < sets )
+      setsLog++;
+   ASSERT( ( 1 << setsLog ) != sets || setsLog > sdP->maxSetsLog || assoc > sdP->maxAssoc,
+           "Size %d assoc %d is outside the profiled range\n", size, assoc );
+   ASSERT( !sdP->keepAddr, "Stack distance profiler was created without an address log\n" );
+
+   cachePT cacheP                    = cacheInit( "SD", size, assoc, sdP->blockSize, 0, POLICY_REP_LRU,
+                                                  POLICY_WRITE_BACK_WRITE_ALLOCATE, NULL );
+   for( long long i = 0; i < sdP->numAddr; i++ )
+      cacheCommunicate( cacheP, (addrT) sdP->addrP[i], CMD_DIR_READ );
+
+   long long expected                = sdMisses( sdP, setsLog, assoc );
+   long long actual                  = cacheP->readMissCount;
+   cacheDestroy( cacheP );
+
+   fprintf( fp, " size %8d assoc %3d : stack distance %9lld cache %9lld %s\n",
+            size, assoc, expected, actual, ( expected == actual ) ? "OK" : "MISMATCH" );
+   return ( expected == actual ) ? 0 : 1;
+}
+
+void sdDestroy( sdPT sdP )
+{
+   for( int k = 0; k <= sdP->maxSetsLog; k++ ){
+      free( sdP->levelP[k].stackP );
+      free( sdP->levelP[k].depthP );
+      free( sdP->levelP[k].hist );
+   }
+   free( sdP->levelP );
+   free( sdP->addrP );
+   free( sdP );
+}
@@ -0,0 +1,62 @@
+/*H**********************************************************************
+* FILENAME    :       stackdist.h
+* DESCRIPTION :       Contains structures and prototypes for LRU stack
+*                     distance profiling of a trace's memory accesses
+* NOTES       :       One pass gives the LRU miss count of every power
+*                     of 2 set count and associativity (Mattson et al.)
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _STACKDIST_H
+#define _STACKDIST_H
+
+#include "all.h"
+#include "cache.h"
+
+// Pointer translations
+typedef  struct  _sdT                 *sdPT;
+typedef  struct  _sdLevelT            *sdLevelPT;
+
+// Defaults for the profiled range
+#define   SD_MAX_ASSOC                 64
+#define   SD_MAX_SETS_LOG              14
+
+// All sets of one set count (2^setsLog).
+// stackP holds per set LRU stacks of block numbers, MRU first, cut off
+// at maxAssoc. hist[d] counts hits at stack depth d, hist[maxAssoc]
+// counts accesses that are not in the stack (cold or deeper)
+typedef struct _sdLevelT{
+   int                 setsLog;
+   uaddrT*             stackP;
+   int*                depthP;
+   long long*          hist;
+}sdLevelT;
+
+// Stack distance profiler
+typedef struct _sdT{
+   int                 blockSize;
+   int                 boSize;
+   int                 maxAssoc;
+   int                 maxSetsLog;
+   long long           numAccess;
+   sdLevelPT           levelP;
+
+   // Profiled stream, only kept when validating against the cache model
+   boolean             keepAddr;
+   uaddrT*             addrP;
+   long long           numAddr;
+   long long           addrCap;
+}sdT;
+
+sdPT       sdInit( int blockSize, int maxAssoc, int maxSetsLog, boolean keepAddr );
+void       sdAccess( sdPT sdP, uaddrT address );
+long long  sdMisses( sdPT sdP, int setsLog, int assoc );
+void       sdPrintTable( sdPT sdP, FILE* fp );
+int        sdValidate( sdPT sdP, int size, int assoc, FILE* fp );
+void       sdDestroy( sdPT sdP );
+#endif
@@ -0,0 +1,148 @@
+/*H**********************************************************************
+* FILENAME    :       sweep.c
+* DESCRIPTION :       Consists multi configuration sweep related operations
+* NOTES       :       Every configuration gets its own dsT and caches,
+*                     only the decoded trace is shared
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+#include "sweep.h"
+#include <unistd.h>
+
+// Reads the configuration list and decodes the trace once.
+// Config file has one "S N BLOCKSIZE L1_size L1_assoc L2_size L2_assoc"
+// per line, blank lines and lines starting with # are skipped
+sweepPT  sweepInit( char* cfgFile, char* traceFile, boolean eventDriven,
+                    boolean (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* ) )
+{
+   // Calloc the mem to reset all vars to 0
+   sweepPT sweepP                    = (sweepPT) calloc( 1, sizeof(sweepT) );
+   ASSERT( !sweepP, "Unable to create sweep" );
+   sweepP->eventDriven               = eventDriven;
+   sweepP->fetchFP                   = fetchFP;
+
+   FILE* fp                          = fopen( cfgFile, "r" );
+   ASSERT( !fp, "Unable to read file: %s\n", cfgFile );
+
+   char line[256];
+   int lineNum                       = 0;
+   while( fgets( line, sizeof(line), fp ) ){
+      lineNum++;
+      char* p                        = line;
+      while( *p == ' ' || *p == '\t' ) p++;
+      if( *p == '#' || *p == '\n' || *p == '\r' || *p == '\0' ) continue;
+
+      sweepCfgT cfg;
+      memset( &cfg, 0, sizeof(cfg) );
+      int numRead                    = sscanf( p, "%d %d %d %d %d %d %d", &cfg.s, &cfg.n, &cfg.blockSize,
+                                               &cfg.l1Size, &cfg.l1Assoc, &cfg.l2Size, &cfg.l2Assoc );
+      ASSERT( numRead != 7, "%s:%d: expected S N BLOCKSIZE L1_size L1_assoc L2_size L2_assoc\n", cfgFile, lineNum );
+      ASSERT( cfg.s <= 0 || cfg.n <= 0, "%s:%d: S and N must be positive\n", cfgFile, lineNum );
+      sweepAddCfg( sweepP, &cfg );
+   }
+   fclose( fp );
+
+   sweepP->recsP                     = traceLoad( traceFile, &sweepP->numRecs );
+   ASSERT( !sweepP->recsP, "Unable to read file: %s\n", traceFile );
+   return sweepP;
+}
+
+void sweepAddCfg( sweepPT sweepP, sweepCfgPT cfgP )
+{
+   if( sweepP->numCfgs == sweepP->cfgCap ){
+      sweepP->cfgCap                 = ( sweepP->cfgCap > 0 ) ? 2 * sweepP->cfgCap : 16;
+      sweepP->cfgP                   = (sweepCfgPT) realloc( sweepP->cfgP, sweepP->cfgCap * sizeof(sweepCfgT) );
+      ASSERT( !sweepP->cfgP, "Unable to grow sweep configurations" );
+   }
+   sweepP->cfgP[ sweepP->numCfgs++ ] = *cfgP;
+}
+
+// Runs all configurations on numThreads workers, 0 == one per online CPU.
+// Results land in the sweepCfgT of each configuration
+void sweepRun( sweepPT sweepP, int numThreads )
+{
+   if( numThreads <= 0 )
+      numThreads                     = (int) sysconf( _SC_NPROCESSORS_ONLN );
+   if( numThreads > sweepP->numCfgs )
+      numThreads                     = sweepP->numCfgs;
+   if( numThreads <= 0 )
+      numThreads                     = 1;
+
+   sweepP->nextCfg                   = 0;
+   pthread_t* threadP                = (pthread_t*) calloc( numThreads, sizeof(pthread_t) );
+   ASSERT( !threadP, "Unable to create sweep workers" );
+
+   // The calling thread is worker 0
+   for( int i = 1; i < numThreads; i++ )
+      ASSERT( pthread_create( &threadP[i], NULL, sweepWorker, sweepP ) != 0, "Unable to start sweep worker" );
+   sweepWorker( sweepP );
+   for( int i = 1; i < numThreads; i++ )
+      pthread_join( threadP[i], NULL );
+
+   free( threadP );
+}
+
+// Pulls configurations until none are left
+void* sweepWorker( void* dataP )
+{
+   sweepPT sweepP                    = (sweepPT) dataP;
+   while( TRUE ){
+      int cfgIndex                   = __atomic_fetch_add( &sweepP->nextCfg, 1, __ATOMIC_RELAXED );
+      if( cfgIndex >= sweepP->numCfgs ) break;
+      sweepSimulate( sweepP, &sweepP->cfgP[ cfgIndex ] );
+   }
+   return NULL;
+}
+
+// Same as a single sim run with the retire log switched off
+void sweepSimulate( sweepPT sweepP, sweepCfgPT cfgP )
+{
+   tracePT traceP                    = traceOpenMem( sweepP->recsP, sweepP->numRecs );
+   dsPT dsP                          = dynamicSchedulerInit( "DS", NULL, traceP, cfgP->s, cfgP->n, sweepP->fetchFP,
+                                                             cfgP->blockSize, cfgP->l1Size, cfgP->l1Assoc,
+                                                             cfgP->l2Size, cfgP->l2Assoc );
+   dsP->eventDriven                  = sweepP->eventDriven;
+   while( !dsProcess( dsP ) );
+
+   cfgP->numInstructions             = dsP->numInstructions;
+   // Cycle - 1 as it stands one ahead
+   cfgP->cycles                      = dsP->cycle - 1;
+   if( dsP->l1P ){
+      cfgP->l1Accesses               = dsP->l1P->readHitCount + dsP->l1P->readMissCount;
+      cfgP->l1Misses                 = dsP->l1P->readMissCount;
+   }
+   if( dsP->l2P ){
+      cfgP->l2Accesses               = dsP->l2P->readHitCount + dsP->l2P->readMissCount;
+      cfgP->l2Misses                 = dsP->l2P->readMissCount;
+   }
+
+   dsDestroy( dsP );
+   traceClose( traceP );
+}
+
+// One row per configuration, in config file order
+void sweepPrintResults( sweepPT sweepP, FILE* fp )
+{
+   fprintf( fp, "#%6s %4s %5s %8s %5s %8s %5s %10s %10s %6s %10s %10s %10s %10s\n",
+            "S", "N", "BLOCK", "L1_SIZE", "L1_AS", "L2_SIZE", "L2_AS",
+            "INSTS", "CYCLES", "IPC", "L1_ACC", "L1_MISS", "L2_ACC", "L2_MISS" );
+   for( int i = 0; i < sweepP->numCfgs; i++ ){
+      sweepCfgPT cfgP                = &sweepP->cfgP[i];
+      fprintf( fp, " %6d %4d %5d %8d %5d %8d %5d %10" PRIcount " %10" PRIcount " %6.2f %10" PRIcount " %10" PRIcount " %10" PRIcount " %10" PRIcount "\n",
+               cfgP->s, cfgP->n, cfgP->blockSize, cfgP->l1Size, cfgP->l1Assoc, cfgP->l2Size, cfgP->l2Assoc,
+               cfgP->numInstructions, cfgP->cycles, (double)cfgP->numInstructions / (double)cfgP->cycles,
+               cfgP->l1Accesses, cfgP->l1Misses, cfgP->l2Accesses, cfgP->l2Misses );
+   }
+}
+
+void sweepDestroy( sweepPT sweepP )
+{
+   free( sweepP->recsP );
+   free( sweepP->cfgP );
+   free( sweepP );
+}
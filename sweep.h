@@ -0,0 +1,67 @@
+/*H**********************************************************************
+* FILENAME    :       sweep.h
+* DESCRIPTION :       Contains structures and prototypes for running
+*                     many scheduler configurations over one trace
+* NOTES       :       -NA-
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include "all.h"
+#include "ds.h"
+
+// Pointer translations
+typedef  struct  _sweepT              *sweepPT;
+typedef  struct  _sweepCfgT           *sweepCfgPT;
+
+// One configuration, same fields as the sim command line, and its results
+typedef struct _sweepCfgT{
+   int                 s;
+   int                 n;
+   int                 blockSize;
+   int                 l1Size;
+   int                 l1Assoc;
+   int                 l2Size;
+   int                 l2Assoc;
+
+   // Results
+   countT              numInstructions;
+   countT              cycles;
+   countT              l1Accesses;
+   countT              l1Misses;
+   countT              l2Accesses;
+   countT              l2Misses;
+}sweepCfgT;
+
+// Sweep state shared by all workers.
+// The decoded trace is read only. Workers claim configurations by bumping
+// nextCfg and write nothing but their own sweepCfgT
+typedef struct _sweepT{
+   sweepCfgPT          cfgP;
+   int                 numCfgs;
+   int                 cfgCap;
+   int                 nextCfg;
+
+   traceRecPT          recsP;
+   size_t              numRecs;
+
+   boolean             eventDriven;
+   boolean             (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* );
+}sweepT;
+
+sweepPT    sweepInit( char* cfgFile, char* traceFile, boolean eventDriven,
+                      boolean (*fetchFP)( dsPT, addrT*, int*, int*, int*, int*, addrT* ) );
+void       sweepAddCfg( sweepPT sweepP, sweepCfgPT cfgP );
+void       sweepRun( sweepPT sweepP, int numThreads );
+void*      sweepWorker( void* dataP );
+void       sweepSimulate( sweepPT sweepP, sweepCfgPT cfgP );
+void       sweepPrintResults( sweepPT sweepP, FILE* fp );
+void       sweepDestroy( sweepPT sweepP );
+#endif
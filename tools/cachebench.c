@@ -0,0 +1,113 @@
+/*H**********************************************************************
+* FILENAME    :       cachebench.c
+* DESCRIPTION :       Microbenchmark for cache lookup and replacement
+*                     across associativities
+* NOTES       :       Usage: cachebench [accesses]
+*                     64 sets of 64B blocks, assoc 1 .. 64. The address
+*                     stream mixes a hot region that fits the cache with
+*                     a uniform walk over 4x the cache, so every run sees
+*                     both hits and evictions. A second table sweeps the
+*                     LRFU lambda and checks the decay tables against pow
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <float.h>
+#include "cache.h"
+
+#define BENCH_SETS       64
+#define BENCH_BLOCK      64
+#define BENCH_LRFU_ASSOC 16
+
+double benchNow()
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Returns ns per access, miss rate through missRateP
+double benchRun( int assoc, replacementPolicyT policy, double lambda, long accesses, double* missRateP )
+{
+   int size                   = BENCH_SETS * assoc * BENCH_BLOCK;
+   cachePT cacheP             = cacheInit( "BENCH", size, assoc, BENCH_BLOCK, lambda, policy,
+                                           POLICY_WRITE_BACK_WRITE_ALLOCATE, NULL );
+
+   // Pregenerate so the generator stays out of the timing
+   int* addrP                 = (int*) malloc( accesses * sizeof(int) );
+   ASSERT( !addrP, "Unable to allocate %ld addresses", accesses );
+   unsigned int seed          = 1;
+   for( long i = 0; i < accesses; i++ ){
+      seed                    = seed * 1103515245 + 12345;
+      unsigned int r          = seed >> 8;
+      if( r & 1 )
+         addrP[i]             = ( r >> 1 ) % ( size / 2 );
+      else
+         addrP[i]             = ( r >> 1 ) % ( 4 * size );
+   }
+
+   double start               = benchNow();
+   for( long i = 0; i < accesses; i++ )
+      cacheCommunicate( cacheP, addrP[i], CMD_DIR_READ );
+   double elapsed             = benchNow() - start;
+
+   *missRateP                 = (double) cacheP->readMissCount / accesses;
+   cacheDestroy( cacheP );
+   free( addrP );
+   return elapsed * 1e9 / accesses;
+}
+
+// Worst relative error of the decay tables against pow, over every dt
+// below 2^16 and a spread of larger ones, where pow does not underflow
+double benchDecayError( double lambda )
+{
+   cachePT cacheP             = cacheInit( "DECAY", BENCH_BLOCK, 1, BENCH_BLOCK, lambda, POLICY_REP_LRFU,
+                                           POLICY_WRITE_BACK_WRITE_ALLOCATE, NULL );
+   double maxErr              = 0;
+   for( long dt = 0; dt < 0x7FFFFFFF; dt = ( dt < 65536 ) ? dt + 1 : dt * 5 / 4 ){
+      double ref              = pow( 0.5, lambda * dt );
+      if( ref < DBL_MIN ) break;
+      double err              = fabs( cacheDecay( cacheP, (countT) dt ) - ref ) / ref;
+      if( err > maxErr )
+         maxErr               = err;
+   }
+   cacheDestroy( cacheP );
+   return maxErr;
+}
+
+int main( int argc, char** argv )
+{
+   long accesses              = ( argc > 1 ) ? atol( argv[1] ) : 2000000;
+   replacementPolicyT policy[]= { POLICY_REP_LRU, POLICY_REP_PLRU, POLICY_REP_LFU };
+   int numPolicy              = sizeof(policy) / sizeof(policy[0]);
+
+   printf( "%6s", "ASSOC" );
+   for( int p = 0; p < numPolicy; p++ )
+      printf( " %8s ns %6s miss", cacheGetNameReplacementPolicyT( policy[p] ), "" );
+   printf( "\n" );
+
+   for( int assoc = 1; assoc <= 64; assoc *= 2 ){
+      printf( "%6d", assoc );
+      for( int p = 0; p < numPolicy; p++ ){
+         double missRate;
+         double ns            = benchRun( assoc, policy[p], 0, accesses, &missRate );
+         printf( " %11.1f %11.4f", ns, missRate );
+      }
+      printf( "\n" );
+   }
+
+   printf( "\n%6s %11s %11s %14s\n", "LAMBDA", "LRFU ns", "miss", "max rel err" );
+   for( int i = 0; i <= 10; i++ ){
+      double lambda           = i / 10.0;
+      double missRate;
+      double ns               = benchRun( BENCH_LRFU_ASSOC, POLICY_REP_LRFU, lambda, accesses, &missRate );
+      printf( "%6.1f %11.1f %11.4f %14.3e\n", lambda, ns, missRate, benchDecayError( lambda ) );
+   }
+   return 0;
+}
@@ -0,0 +1,81 @@
+/*H**********************************************************************
+* FILENAME    :       fifobench.c
+* DESCRIPTION :       Microbenchmark for moving instructions out of a
+*                     scheduling queue of size S
+* NOTES       :       Usage: fifobench [cycles]
+*                     Every cycle removes N random entries and pushes N
+*                     new ones, once by sequence number scan (the old
+*                     dsInstSeqNum way) and once by handle
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include "fifo.h"
+
+#define BENCH_N          8
+
+typedef struct _benchEntryT{
+   int                 sequenceNum;
+   int                 handle;
+}benchEntryT;
+
+double benchNow()
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+boolean benchSeqNum( int* seqNum, benchEntryT* entryP )
+{
+   return ( entryP->sequenceNum == *seqNum ) ? TRUE : FALSE;
+}
+
+// Returns ns per simulated cycle
+double benchRun( int s, long cycles, boolean byHandle )
+{
+   fifoPT fifoP               = fifoInit( s );
+   benchEntryT* entryP        = (benchEntryT*) calloc( s, sizeof(benchEntryT) );
+   int seqNum                 = 0;
+   for( int i = 0; i < s; i++ ){
+      entryP[i].sequenceNum   = seqNum++;
+      fifoPushHandle( fifoP, &entryP[i], &entryP[i].handle );
+   }
+
+   unsigned int seed          = 1;
+   double start               = benchNow();
+   for( long cycle = 0; cycle < cycles; cycle++ ){
+      for( int i = 0; i < BENCH_N; i++ ){
+         seed                 = seed * 1103515245 + 12345;
+         benchEntryT* victimP = &entryP[ ( seed >> 8 ) % s ];
+         if( byHandle )
+            fifoRemoveHandle( fifoP, victimP->handle );
+         else
+            fifoSearchOpRemove( fifoP, benchSeqNum, NULL, &victimP->sequenceNum, TRUE );
+         victimP->sequenceNum = seqNum++;
+         fifoPushHandle( fifoP, victimP, &victimP->handle );
+      }
+   }
+   double elapsed             = benchNow() - start;
+
+   fifoDestroy( fifoP );
+   free( entryP );
+   return elapsed * 1e9 / cycles;
+}
+
+int main( int argc, char** argv )
+{
+   long cycles                = ( argc > 1 ) ? atol( argv[1] ) : 200000;
+
+   printf( "%6s %14s %14s\n", "S", "scan ns/cyc", "handle ns/cyc" );
+   for( int s = 8; s <= 1024; s *= 2 ){
+      printf( "%6d %14.1f %14.1f\n", s, benchRun( s, cycles, FALSE ), benchRun( s, cycles, TRUE ) );
+   }
+   return 0;
+}
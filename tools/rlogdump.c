@@ -0,0 +1,41 @@
+/*H**********************************************************************
+* FILENAME    :       rlogdump.c
+* DESCRIPTION :       Prints a binary retire log in the text format
+*                     sim writes by default
+* NOTES       :       Usage: rlogdump <binary-retire-log>
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "rlog.h"
+
+int main( int argc, char** argv )
+{
+   if( argc != 2 ){
+      fprintf( stderr, "Usage: rlogdump <binary-retire-log>\n" );
+      exit(1);
+   }
+
+   FILE* fp                = fopen( argv[1], "rb" );
+   ASSERT( !fp, "Unable to open file: %s\n", argv[1] );
+
+   unsigned long long numRecords;
+   ASSERT( !rlogReadHeader( fp, &numRecords ), "%s is not a binary retire log\n", argv[1] );
+
+   rlogPT rlogP            = rlogOpen( stdout, RLOG_FMT_TEXT, FALSE );
+   rlogRecT rec;
+   unsigned long long numRead = 0;
+   while( rlogReadBin( fp, &rec ) ){
+      rlogWrite( rlogP, &rec );
+      numRead++;
+   }
+   rlogClose( rlogP );
+
+   // 0 in the header means the writer could not seek back
+   ASSERT( numRecords != 0 && numRecords != numRead, "Truncated retire log: %llu of %llu records\n", numRead, numRecords );
+   fclose( fp );
+   return 0;
+}
@@ -0,0 +1,220 @@
+/*H**********************************************************************
+* FILENAME    :       simbench.c
+* DESCRIPTION :       Throughput benchmark of the whole simulator over a
+*                     matrix of traces and configurations
+* NOTES       :       Usage: simbench <matrix> <out.csv> [--sim=<path>]
+*                            [--repeat=<R>] [--compare=<baseline.csv>]
+*                            [--threshold=<percent>]
+*                     Every matrix line is "name trace S N BLOCKSIZE
+*                     L1_size L1_assoc L2_size L2_assoc [sim options]".
+*                     sim runs with --retire-log=none --stats, best wall
+*                     time of R runs is kept. With --compare the exit
+*                     status is 1 if any KIPS fell more than threshold
+*                     percent below the baseline row of the same name.
+*                     Runs under BENCH_MIN_GATE seconds are not gated
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "all.h"
+
+#define BENCH_MAX_ARGS   32
+// Runs shorter than this are mostly process start up, they are reported
+// but never fail the comparison
+#define BENCH_MIN_GATE   0.1
+
+// One matrix line and what it measured
+typedef struct _benchRowT{
+   char                name[64];
+   long long           instructions;
+   long long           cycles;
+   double              seconds;
+   long                peakRssKb;
+   long long           heapAllocs;
+}benchRowT;
+
+double benchNow()
+{
+   struct timespec ts;
+   clock_gettime( CLOCK_MONOTONIC, &ts );
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double benchKips( benchRowT* rowP )
+{
+   return rowP->instructions / rowP->seconds / 1e3;
+}
+
+// Runs sim once with stdout and stderr on a pipe and picks the counts out
+// of the RESULTS and --stats lines. Peak RSS comes from the child's rusage
+void benchRunOnce( char* simP, char** argP, benchRowT* rowP )
+{
+   int fd[2];
+   ASSERT( pipe( fd ) != 0, "Unable to create pipe" );
+
+   double start               = benchNow();
+   pid_t pid                  = fork();
+   ASSERT( pid < 0, "Unable to fork" );
+   if( pid == 0 ){
+      dup2( fd[1], 1 );
+      dup2( fd[1], 2 );
+      close( fd[0] );
+      close( fd[1] );
+      execv( simP, argP );
+      fprintf( stderr, "Unable to run %s\n", simP );
+      _exit( 127 );
+   }
+   close( fd[1] );
+
+   FILE* fp                   = fdopen( fd[0], "r" );
+   char line[512];
+   while( fgets( line, sizeof(line), fp ) ){
+      sscanf( line, " number of instructions = %lld", &rowP->instructions );
+      sscanf( line, " number of cycles = %lld", &rowP->cycles );
+      sscanf( line, " heap allocations = %lld", &rowP->heapAllocs );
+   }
+   fclose( fp );
+
+   int status;
+   struct rusage usage;
+   wait4( pid, &status, 0, &usage );
+   rowP->seconds              = benchNow() - start;
+   rowP->peakRssKb            = usage.ru_maxrss;
+   ASSERT( !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 || rowP->instructions <= 0,
+           "%s failed on %s", simP, rowP->name );
+}
+
+// Baseline KIPS of name, 0 if the baseline has no such row
+double benchBaselineKips( char* fileP, char* name )
+{
+   FILE* fp                   = fopen( fileP, "r" );
+   ASSERT( !fp, "Unable to read file: %s\n", fileP );
+
+   char line[512];
+   double kips                = 0;
+   while( fgets( line, sizeof(line), fp ) ){
+      char rowName[64];
+      double rowKips;
+      if( sscanf( line, "%63[^,],%*[^,],%*[^,],%*[^,],%lf", rowName, &rowKips ) == 2 &&
+          strcmp( rowName, name ) == 0 )
+         kips                 = rowKips;
+   }
+   fclose( fp );
+   return kips;
+}
+
+int main( int argc, char** argv )
+{
+   char* simP                 = "./sim";
+   char* baselineP            = NULL;
+   int repeat                 = 3;
+   double threshold           = 10;
+   for( int argIndex = 3; argIndex < argc; argIndex++ ){
+      char* argP              = argv[argIndex];
+      if(      strncmp( argP, "--sim=", 6 ) == 0 ) simP = argP + 6;
+      else if( strncmp( argP, "--repeat=", 9 ) == 0 ) repeat = atoi( argP + 9 );
+      else if( strncmp( argP, "--compare=", 10 ) == 0 ) baselineP = argP + 10;
+      else if( strncmp( argP, "--threshold=", 12 ) == 0 ) threshold = atof( argP + 12 );
+      else argc = 0;
+   }
+   if( argc < 3 || repeat <= 0 ){
+      fprintf( stderr, "Usage: simbench <matrix> <out.csv> [--sim=<path>] [--repeat=<R>]\n" );
+      fprintf( stderr, "                [--compare=<baseline.csv>] [--threshold=<percent>]\n" );
+      exit(1);
+   }
+
+   FILE* matrixFp             = fopen( argv[1], "r" );
+   ASSERT( !matrixFp, "Unable to read file: %s\n", argv[1] );
+   FILE* outFp                = fopen( argv[2], "w" );
+   ASSERT( !outFp, "Unable to create file: %s\n", argv[2] );
+   fprintf( outFp, "name,instructions,cycles,seconds,kips,cycles_per_sec,peak_rss_kb,heap_allocs,allocs_per_inst\n" );
+
+   printf( "%-20s %12s %10s %12s %10s %12s %10s\n", "NAME", "INSTS", "KIPS", "CYCLES/S", "RSS KB", "ALLOCS/INST",
+           ( baselineP ) ? "VS BASE" : "" );
+
+   char line[512];
+   int lineNum                = 0;
+   int numRegressed           = 0;
+   while( fgets( line, sizeof(line), matrixFp ) ){
+      lineNum++;
+      char* p                 = line;
+      while( *p == ' ' || *p == '\t' ) p++;
+      if( *p == '#' || *p == '\n' || *p == '\r' || *p == '\0' ) continue;
+
+      // name, then the sim command line as is
+      char* fieldP[BENCH_MAX_ARGS];
+      int numFields           = 0;
+      for( char* tokP = strtok( p, " \t\r\n" ); tokP; tokP = strtok( NULL, " \t\r\n" ) ){
+         ASSERT( numFields >= BENCH_MAX_ARGS - 3, "%s:%d: too many fields\n", argv[1], lineNum );
+         fieldP[ numFields++ ] = tokP;
+      }
+      ASSERT( numFields < 9, "%s:%d: expected name trace S N BLOCKSIZE L1_size L1_assoc L2_size L2_assoc\n",
+              argv[1], lineNum );
+
+      char* simArgP[BENCH_MAX_ARGS];
+      int numArgs             = 0;
+      simArgP[ numArgs++ ]    = simP;
+      for( int i = 2; i < 9; i++ )
+         simArgP[ numArgs++ ] = fieldP[i];
+      simArgP[ numArgs++ ]    = fieldP[1];
+      for( int i = 9; i < numFields; i++ )
+         simArgP[ numArgs++ ] = fieldP[i];
+      simArgP[ numArgs++ ]    = "--retire-log=none";
+      simArgP[ numArgs++ ]    = "--stats";
+      simArgP[ numArgs ]      = NULL;
+
+      // Best time, worst RSS
+      benchRowT best;
+      long peakRssKb          = 0;
+      for( int run = 0; run < repeat; run++ ){
+         benchRowT row;
+         memset( &row, 0, sizeof(row) );
+         snprintf( row.name, sizeof(row.name), "%s", fieldP[0] );
+         benchRunOnce( simP, simArgP, &row );
+         if( run == 0 || row.seconds < best.seconds )
+            best              = row;
+         if( row.peakRssKb > peakRssKb )
+            peakRssKb         = row.peakRssKb;
+      }
+      best.peakRssKb          = peakRssKb;
+
+      double kips             = benchKips( &best );
+      double allocsPerInst    = (double) best.heapAllocs / best.instructions;
+      fprintf( outFp, "%s,%lld,%lld,%.6f,%.1f,%.0f,%ld,%lld,%.6f\n", best.name, best.instructions, best.cycles,
+               best.seconds, kips, best.cycles / best.seconds, best.peakRssKb, best.heapAllocs, allocsPerInst );
+      printf( "%-20s %12lld %10.1f %12.0f %10ld %12.6f", best.name, best.instructions, kips,
+              best.cycles / best.seconds, best.peakRssKb, allocsPerInst );
+
+      if( baselineP ){
+         double baseKips      = benchBaselineKips( baselineP, best.name );
+         if( baseKips <= 0 ){
+            printf( " %10s", "new" );
+         } else{
+            double change     = 100.0 * ( kips / baseKips - 1.0 );
+            boolean gated     = ( best.seconds >= BENCH_MIN_GATE ) ? TRUE : FALSE;
+            boolean regressed = ( gated && change < -threshold ) ? TRUE : FALSE;
+            printf( " %+9.1f%%%s", change, ( regressed ) ? " REGRESSED" : ( gated ) ? "" : " (short)" );
+            numRegressed     += ( regressed ) ? 1 : 0;
+         }
+      }
+      printf( "\n" );
+      fflush( stdout );
+   }
+   fclose( matrixFp );
+   fclose( outFp );
+
+   if( baselineP && numRegressed > 0 ){
+      printf( "%d configuration(s) more than %.1f%% slower than %s\n", numRegressed, threshold, baselineP );
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,79 @@
+/*H**********************************************************************
+* FILENAME    :       tracecvt.c
+* DESCRIPTION :       Converts between the trace formats understood
+*                     by sim
+* NOTES       :       Usage: tracecvt [-b|-z|-t] <input-trace> <output-trace>
+*                     -b binary (default), -z compressed, -t text.
+*                     Input format is picked by magic number
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+#include "trace.h"
+
+int main( int argc, char** argv )
+{
+   traceFormatT outFormat  = TRACE_FMT_BIN;
+   int argIndex            = 1;
+   if( argc == 4 ){
+      if(      strcmp( argv[1], "-b" ) == 0 ) outFormat = TRACE_FMT_BIN;
+      else if( strcmp( argv[1], "-z" ) == 0 ) outFormat = TRACE_FMT_Z;
+      else if( strcmp( argv[1], "-t" ) == 0 ) outFormat = TRACE_FMT_TEXT;
+      else argc = 0;
+      argIndex             = 2;
+   }
+   if( argc - argIndex != 2 ){
+      fprintf( stderr, "Usage: tracecvt [-b|-z|-t] <input-trace> <output-trace>\n" );
+      exit(1);
+   }
+
+   tracePT traceP          = traceOpen( argv[argIndex] );
+   ASSERT( !traceP, "Unable to open file: %s\n", argv[argIndex] );
+
+   FILE* fp                = fopen( argv[argIndex + 1], "wb" );
+   ASSERT( !fp, "Unable to create file: %s\n", argv[argIndex + 1] );
+
+   // Record count of binary header is patched in once known.
+   // The 64 bit build keeps every address bit
+#ifdef DS_64
+   int flags               = TRACE_BIN_FLAG_PC64 | TRACE_BIN_FLAG_MEM64;
+#else
+   int flags               = 0;
+#endif
+   traceZWriterPT writerP  = NULL;
+   if( outFormat == TRACE_FMT_BIN )
+      traceBinWriteHeader( fp, flags, 0 );
+   else if( outFormat == TRACE_FMT_Z )
+      writerP              = traceZWriterOpen( fp );
+
+   traceRecT rec;
+   unsigned long long numRecords = 0;
+   while( traceRead( traceP, &rec ) ){
+      // Register fields are stored as signed bytes
+      ASSERT( !( rec.operation >= 0 && rec.operation <= 2 ), "Operation can only be 0, 1 or 2" );
+      ASSERT( !( rec.dst  >= -1 && rec.dst  <= 127 ), "dst reg out of bounds[-1, 127]: %d\n" , rec.dst  );
+      ASSERT( !( rec.src1 >= -1 && rec.src1 <= 127 ), "src1 reg out of bounds[-1, 127]: %d\n", rec.src1 );
+      ASSERT( !( rec.src2 >= -1 && rec.src2 <= 127 ), "src2 reg out of bounds[-1, 127]: %d\n", rec.src2 );
+      switch( outFormat ){
+         case TRACE_FMT_BIN : traceBinWriteRec( fp, flags, &rec ); break;
+         case TRACE_FMT_Z   : traceZWrite( writerP, &rec );        break;
+         default            : fprintf( fp, "%" PRIaddr " %d %d %d %d %" PRIaddr "\n", rec.pc, rec.operation, rec.dst, rec.src1, rec.src2, rec.mem ); break;
+      }
+      numRecords++;
+   }
+
+   // Not fatal for non seekable outputs, header then says 0 == unknown
+   if( outFormat == TRACE_FMT_BIN && fseek( fp, 0, SEEK_SET ) == 0 )
+      traceBinWriteHeader( fp, flags, numRecords );
+   else if( outFormat == TRACE_FMT_Z )
+      traceZWriterClose( writerP );
+
+   fseek( fp, 0, SEEK_END );
+   printf( "%s: %llu records, %ld bytes\n", argv[argIndex + 1], numRecords, ftell( fp ) );
+   fclose( fp );
+   traceClose( traceP );
+   return 0;
+}
@@ -0,0 +1,714 @@
+/*H**********************************************************************
+* FILENAME    :       trace.c
+* DESCRIPTION :       Consists all trace reading related operations
+* NOTES       :       Text and binary traces are memory mapped and parsed
+*                     in place to keep fscanf out of the fetch path.
+*                     Compressed traces are streamed block by block
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+// mmap and friends are POSIX, not C99
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sched.h>
+#include "trace.h"
+
+//-------------- PARSER BEGIN ------------------
+
+// Line of the cursor. Only used while reporting errors
+int traceLineNum( tracePT traceP )
+{
+   int lineNum          = 1;
+   for( char* p = traceP->baseP; p < traceP->curP; p++ )
+      lineNum          += ( *p == '\n' ) ? 1 : 0;
+   return lineNum;
+}
+
+inline void traceSkipSpace( tracePT traceP )
+{
+   char* p              = traceP->curP;
+   while( p < traceP->endP && ( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ) )
+      p++;
+   traceP->curP         = p;
+}
+
+// Same as %x of fscanf: optional 0x prefix followed by hex digits.
+// Wraps at the address width like fscanf would
+inline uaddrT traceParseHex( tracePT traceP )
+{
+   traceSkipSpace( traceP );
+   char* p              = traceP->curP;
+   if( traceP->endP - p > 2 && p[0] == '0' && ( p[1] == 'x' || p[1] == 'X' ) )
+      p                += 2;
+
+   char* startP         = p;
+   uaddrT value         = 0;
+   while( p < traceP->endP ){
+      unsigned int digit= (unsigned char) *p - '0';
+      if( digit > 9 ){
+         // Lower case the letter and map a-f to 10-15
+         digit          = ( (unsigned char) *p | 0x20 ) - 'a';
+         if( digit > 5 ) break;
+         digit         += 10;
+      }
+      value             = ( value << 4 ) | digit;
+      p++;
+   }
+   ASSERT( p == startP, "Expected a hex value in %s at line %d", traceP->name, traceLineNum( traceP ) );
+   traceP->curP         = p;
+   return value;
+}
+
+// Same as %d of fscanf: optional sign followed by decimal digits
+inline int traceParseDec( tracePT traceP )
+{
+   traceSkipSpace( traceP );
+   char* p              = traceP->curP;
+   boolean negative     = FALSE;
+   if( p < traceP->endP && ( *p == '-' || *p == '+' ) ){
+      negative          = ( *p == '-' ) ? TRUE : FALSE;
+      p++;
+   }
+
+   char* startP         = p;
+   int value            = 0;
+   while( p < traceP->endP && (unsigned int)( *p - '0' ) <= 9 ){
+      value             = value * 10 + ( *p - '0' );
+      p++;
+   }
+   ASSERT( p == startP, "Expected a decimal value in %s at line %d", traceP->name, traceLineNum( traceP ) );
+   traceP->curP         = p;
+   return ( negative ) ? -value : value;
+}
+
+//-------------- PARSER END   ------------------
+
+//-------------- BINARY BEGIN ------------------
+
+inline unsigned int traceGetU16( unsigned char* p )
+{
+   return (unsigned int) p[0] | ( (unsigned int) p[1] << 8 );
+}
+
+inline unsigned int traceGetU32( unsigned char* p )
+{
+   return (unsigned int) p[0]         | ( (unsigned int) p[1] << 8 ) |
+          ( (unsigned int) p[2] << 16 ) | ( (unsigned int) p[3] << 24 );
+}
+
+inline unsigned long long traceGetU64( unsigned char* p )
+{
+   return (unsigned long long) traceGetU32( p ) | ( (unsigned long long) traceGetU32( p + 4 ) << 32 );
+}
+
+void tracePutU( FILE* fp, unsigned long long value, int numBytes )
+{
+   unsigned char buf[8];
+   for( int i = 0; i < numBytes; i++ )
+      buf[i]            = ( value >> ( 8 * i ) ) & 0xFF;
+   fwrite( buf, 1, numBytes, fp );
+}
+
+int traceBinRecSize( int flags )
+{
+   return ( ( flags & TRACE_BIN_FLAG_PC64  ) ? 8 : 4 ) + 4 +
+          ( ( flags & TRACE_BIN_FLAG_MEM64 ) ? 8 : 4 );
+}
+
+void traceBinWriteHeader( FILE* fp, int flags, unsigned long long numRecords )
+{
+   fwrite( TRACE_BIN_MAGIC, 1, 4, fp );
+   tracePutU( fp, TRACE_BIN_VERSION, 2 );
+   tracePutU( fp, flags, 2 );
+   tracePutU( fp, numRecords, 8 );
+}
+
+void traceBinWriteRec( FILE* fp, int flags, traceRecPT recP )
+{
+   tracePutU( fp, (uaddrT) recP->pc, ( flags & TRACE_BIN_FLAG_PC64 ) ? 8 : 4 );
+   tracePutU( fp, recP->operation , 1 );
+   tracePutU( fp, recP->dst       , 1 );
+   tracePutU( fp, recP->src1      , 1 );
+   tracePutU( fp, recP->src2      , 1 );
+   tracePutU( fp, (uaddrT) recP->mem, ( flags & TRACE_BIN_FLAG_MEM64 ) ? 8 : 4 );
+}
+
+// Validates the header of a mapped binary trace and positions the cursor
+// at the first record
+void traceBinOpen( tracePT traceP )
+{
+   unsigned char* p                  = (unsigned char*) traceP->baseP;
+   ASSERT( traceP->size < TRACE_BIN_HEADER_SIZE, "Truncated header in binary trace %s", traceP->name );
+
+   int version                       = traceGetU16( p + 4 );
+   ASSERT( version != TRACE_BIN_VERSION, "Unsupported binary trace version %d in %s", version, traceP->name );
+
+   traceP->format                    = TRACE_FMT_BIN;
+   traceP->flags                     = traceGetU16( p + 6 );
+   traceP->recSize                   = traceBinRecSize( traceP->flags );
+
+   unsigned long long numRecords     = traceGetU64( p + 8 );
+   size_t payload                    = traceP->size - TRACE_BIN_HEADER_SIZE;
+   ASSERT( payload % traceP->recSize != 0, "Binary trace %s is not a whole number of records", traceP->name );
+   ASSERT( numRecords != 0 && numRecords != payload / traceP->recSize,
+           "Binary trace %s has %llu records, header says %llu", traceP->name,
+           (unsigned long long) ( payload / traceP->recSize ), numRecords );
+
+   traceP->curP                      = traceP->baseP + TRACE_BIN_HEADER_SIZE;
+}
+
+boolean traceReadBin( tracePT traceP, traceRecPT recP )
+{
+   if( traceP->curP >= traceP->endP ) return FALSE;
+
+   unsigned char* p                  = (unsigned char*) traceP->curP;
+   if( traceP->flags & TRACE_BIN_FLAG_PC64 ){
+      recP->pc                       = (addrT) traceGetU64( p );
+      p                             += 8;
+   } else{
+      recP->pc                       = (addrT) traceGetU32( p );
+      p                             += 4;
+   }
+   recP->operation                   = p[0];
+   recP->dst                         = (signed char) p[1];
+   recP->src1                        = (signed char) p[2];
+   recP->src2                        = (signed char) p[3];
+   p                                += 4;
+   recP->mem                         = ( traceP->flags & TRACE_BIN_FLAG_MEM64 ) ? (addrT) traceGetU64( p ) : (addrT) traceGetU32( p );
+
+   traceP->curP                     += traceP->recSize;
+   return TRUE;
+}
+
+//-------------- BINARY END   ------------------
+
+//-------------- COMPRESSED BEGIN --------------
+
+// Deltas are taken modulo the address width, so a 32 bit build writes
+// exactly the bytes it always did
+inline unsigned long long traceZigZag( addrT value )
+{
+   return ( (uaddrT) value << 1 ) ^ (uaddrT) ( value >> ( ADDR_BITS - 1 ) );
+}
+
+inline addrT traceUnZigZag( unsigned long long value )
+{
+   return (addrT) ( value >> 1 ) ^ -(addrT) ( value & 1 );
+}
+
+inline unsigned char* tracePutVarint( unsigned char* p, unsigned long long value )
+{
+   while( value >= 0x80 ){
+      *p++              = ( value & 0x7F ) | 0x80;
+      value           >>= 7;
+   }
+   *p++                 = value;
+   return p;
+}
+
+inline unsigned long long traceGetVarint( tracePT traceP )
+{
+   unsigned char* p     = (unsigned char*) traceP->curP;
+   unsigned long long value = 0;
+   int shift            = 0;
+   do{
+      ASSERT( p >= (unsigned char*) traceP->endP || shift > 63, "Corrupt varint in compressed trace %s", traceP->name );
+      value            |= (unsigned long long) ( *p & 0x7F ) << shift;
+      shift            += 7;
+   } while( *p++ & 0x80 );
+   traceP->curP         = (char*) p;
+   return value;
+}
+
+inline traceZDictPT traceZDictLookup( traceZDictPT dictP, addrT pc )
+{
+   return &dictP[ ( (uaddrT) pc >> 2 ) & ( TRACE_Z_DICT_SIZE - 1 ) ];
+}
+
+// Common to compressor and decompressor so that both sides predict alike
+inline void traceZDictUpdate( traceZDictPT entryP, traceRecPT recP )
+{
+   if( !entryP->valid || entryP->pc != recP->pc ){
+      entryP->valid     = TRUE;
+      entryP->pc        = recP->pc;
+      entryP->lastMem   = 0;
+      entryP->stride    = 0;
+   }
+   entryP->operation    = recP->operation;
+   entryP->dst          = recP->dst;
+   entryP->src1         = recP->src1;
+   entryP->src2         = recP->src2;
+   if( recP->mem != 0 ){
+      entryP->stride    = ( entryP->lastMem != 0 ) ? (addrT) ( (uaddrT) recP->mem - (uaddrT) entryP->lastMem ) : 0;
+      entryP->lastMem   = recP->mem;
+   }
+}
+
+// Reads exactly numBytes unless end of file is hit first
+size_t traceReadFully( int fd, void* bufP, size_t numBytes )
+{
+   size_t done          = 0;
+   while( done < numBytes ){
+      ssize_t got       = read( fd, (char*) bufP + done, numBytes - done );
+      if( got <= 0 ) break;
+      done             += got;
+   }
+   return done;
+}
+
+// Compressed traces are streamed block by block instead of being mapped
+// so that memory use does not depend on trace length
+void traceZOpen( tracePT traceP )
+{
+   unsigned char header[TRACE_BIN_HEADER_SIZE];
+   ASSERT( traceReadFully( traceP->fd, header, TRACE_BIN_HEADER_SIZE ) != TRACE_BIN_HEADER_SIZE,
+           "Truncated header in compressed trace %s", traceP->name );
+
+   int version                       = traceGetU16( header + 4 );
+   ASSERT( version != TRACE_Z_VERSION, "Unsupported compressed trace version %d in %s", version, traceP->name );
+
+   traceP->format                    = TRACE_FMT_Z;
+   traceP->flags                     = traceGetU16( header + 6 );
+   traceP->blockP                    = (unsigned char*) malloc( TRACE_Z_BLOCK_RECS * TRACE_Z_MAX_REC_BYTES );
+   traceP->dictP                     = (traceZDictPT) calloc( TRACE_Z_DICT_SIZE, sizeof(traceZDictT) );
+   ASSERT( !traceP->blockP || !traceP->dictP, "Unable to create compressed trace buffers" );
+   traceP->blockRecs                 = 0;
+}
+
+// Pulls the next block in. Returns FALSE at the end of trace
+boolean traceZReadBlock( tracePT traceP )
+{
+   unsigned char header[8];
+   size_t got                        = traceReadFully( traceP->fd, header, 8 );
+   if( got == 0 ) return FALSE;
+   ASSERT( got != 8, "Truncated block header in compressed trace %s", traceP->name );
+
+   int numRecs                       = traceGetU32( header );
+   unsigned int numBytes             = traceGetU32( header + 4 );
+   ASSERT( numRecs <= 0 || numRecs > TRACE_Z_BLOCK_RECS || numBytes > (unsigned int) numRecs * TRACE_Z_MAX_REC_BYTES,
+           "Corrupt block header in compressed trace %s", traceP->name );
+   ASSERT( traceReadFully( traceP->fd, traceP->blockP, numBytes ) != numBytes,
+           "Truncated block in compressed trace %s", traceP->name );
+
+   // Every block starts from scratch
+   memset( traceP->dictP, 0, TRACE_Z_DICT_SIZE * sizeof(traceZDictT) );
+   traceP->prevPc                    = 0;
+   traceP->blockRecs                 = numRecs;
+   traceP->curP                      = (char*) traceP->blockP;
+   traceP->endP                      = (char*) traceP->blockP + numBytes;
+   return TRUE;
+}
+
+boolean traceReadZ( tracePT traceP, traceRecPT recP )
+{
+   if( traceP->blockRecs == 0 && !traceZReadBlock( traceP ) ) return FALSE;
+
+   ASSERT( traceP->curP >= traceP->endP, "Corrupt block in compressed trace %s", traceP->name );
+   int flags                         = (unsigned char) *traceP->curP++;
+
+   addrT pc                          = (addrT) ( (uaddrT) traceP->prevPc + 4 );
+   if( !( flags & TRACE_Z_PC_SEQ ) )
+      pc                             = (addrT) ( (uaddrT) pc + (uaddrT) traceUnZigZag( traceGetVarint( traceP ) ) );
+   recP->pc                          = pc;
+
+   traceZDictPT entryP               = traceZDictLookup( traceP->dictP, pc );
+   boolean known                     = entryP->valid && entryP->pc == pc;
+   if( flags & TRACE_Z_REGS_HIT ){
+      ASSERT( !known, "Dictionary miss in compressed trace %s", traceP->name );
+      recP->operation                = entryP->operation;
+      recP->dst                      = entryP->dst;
+      recP->src1                     = entryP->src1;
+      recP->src2                     = entryP->src2;
+   } else{
+      ASSERT( traceP->endP - traceP->curP < 4, "Corrupt block in compressed trace %s", traceP->name );
+      recP->operation                = (unsigned char) traceP->curP[0];
+      recP->dst                      = (signed char) traceP->curP[1];
+      recP->src1                     = (signed char) traceP->curP[2];
+      recP->src2                     = (signed char) traceP->curP[3];
+      traceP->curP                  += 4;
+   }
+
+   addrT base                        = ( known ) ? entryP->lastMem : 0;
+   if( flags & TRACE_Z_MEM_ZERO ){
+      recP->mem                      = 0;
+   } else if( flags & TRACE_Z_MEM_STRIDE ){
+      recP->mem                      = (addrT) ( (uaddrT) base + (uaddrT) entryP->stride );
+   } else{
+      recP->mem                      = (addrT) ( (uaddrT) base + (uaddrT) traceUnZigZag( traceGetVarint( traceP ) ) );
+   }
+
+   traceZDictUpdate( entryP, recP );
+   traceP->prevPc                    = pc;
+
+   // Block must be consumed exactly
+   if( --traceP->blockRecs == 0 )
+      ASSERT( traceP->curP != traceP->endP, "Trailing bytes in block of compressed trace %s", traceP->name );
+   return TRUE;
+}
+
+traceZWriterPT traceZWriterOpen( FILE* fp )
+{
+   traceZWriterPT writerP            = (traceZWriterPT) calloc( 1, sizeof(traceZWriterT) );
+   ASSERT( !writerP, "Unable to create compressed trace writer" );
+   writerP->fp                       = fp;
+   writerP->blockP                   = (unsigned char*) malloc( TRACE_Z_BLOCK_RECS * TRACE_Z_MAX_REC_BYTES );
+   ASSERT( !writerP->blockP, "Unable to create compressed trace writer" );
+
+   // Record count is patched in at close
+   fwrite( TRACE_Z_MAGIC, 1, 4, fp );
+   tracePutU( fp, TRACE_Z_VERSION, 2 );
+   tracePutU( fp, 0, 2 );
+   tracePutU( fp, 0, 8 );
+   return writerP;
+}
+
+void traceZWrite( traceZWriterPT writerP, traceRecPT recP )
+{
+   unsigned char* p                  = writerP->blockP + writerP->blockBytes;
+   unsigned char* flagP              = p++;
+   int flags                         = 0;
+
+   addrT seqPc                       = (addrT) ( (uaddrT) writerP->prevPc + 4 );
+   if( recP->pc == seqPc ){
+      flags                         |= TRACE_Z_PC_SEQ;
+   } else{
+      p                              = tracePutVarint( p, traceZigZag( (addrT) ( (uaddrT) recP->pc - (uaddrT) seqPc ) ) );
+   }
+
+   traceZDictPT entryP               = traceZDictLookup( writerP->dict, recP->pc );
+   boolean known                     = entryP->valid && entryP->pc == recP->pc;
+   if( known && entryP->operation == recP->operation && entryP->dst == recP->dst &&
+       entryP->src1 == recP->src1 && entryP->src2 == recP->src2 ){
+      flags                         |= TRACE_Z_REGS_HIT;
+   } else{
+      *p++                           = recP->operation;
+      *p++                           = recP->dst;
+      *p++                           = recP->src1;
+      *p++                           = recP->src2;
+   }
+
+   addrT base                        = ( known ) ? entryP->lastMem : 0;
+   if( recP->mem == 0 ){
+      flags                         |= TRACE_Z_MEM_ZERO;
+   } else if( known && recP->mem == (addrT) ( (uaddrT) base + (uaddrT) entryP->stride ) ){
+      flags                         |= TRACE_Z_MEM_STRIDE;
+   } else{
+      p                              = tracePutVarint( p, traceZigZag( (addrT) ( (uaddrT) recP->mem - (uaddrT) base ) ) );
+   }
+   *flagP                            = flags;
+
+   traceZDictUpdate( entryP, recP );
+   writerP->prevPc                   = recP->pc;
+   writerP->blockBytes               = p - writerP->blockP;
+   writerP->numRecords++;
+   if( ++writerP->blockRecs == TRACE_Z_BLOCK_RECS )
+      traceZFlushBlock( writerP );
+}
+
+void traceZFlushBlock( traceZWriterPT writerP )
+{
+   if( writerP->blockRecs == 0 ) return;
+   tracePutU( writerP->fp, writerP->blockRecs, 4 );
+   tracePutU( writerP->fp, writerP->blockBytes, 4 );
+   fwrite( writerP->blockP, 1, writerP->blockBytes, writerP->fp );
+
+   // Every block starts from scratch
+   memset( writerP->dict, 0, sizeof(writerP->dict) );
+   writerP->prevPc                   = 0;
+   writerP->blockRecs                = 0;
+   writerP->blockBytes               = 0;
+}
+
+// Flushes the last block and patches the record count. Does not close fp
+void traceZWriterClose( traceZWriterPT writerP )
+{
+   traceZFlushBlock( writerP );
+   // Not fatal for non seekable outputs, header then says 0 == unknown
+   if( fseek( writerP->fp, 8, SEEK_SET ) == 0 ){
+      tracePutU( writerP->fp, writerP->numRecords, 8 );
+      fseek( writerP->fp, 0, SEEK_END );
+   }
+   free( writerP->blockP );
+   free( writerP );
+}
+
+//-------------- COMPRESSED END   --------------
+
+// Maps the trace file. Returns NULL if the file can not be mapped
+// (pipes, character devices etc) so that the caller can fall back
+// to stdio. Compressed traces are streamed instead, "synth:<N>"
+// generates N records
+tracePT traceOpen( char* fileName )
+{
+   if( strncmp( fileName, TRACE_SYNTH_PREFIX, strlen( TRACE_SYNTH_PREFIX ) ) == 0 )
+      return traceOpenSynthetic( strtoull( fileName + strlen( TRACE_SYNTH_PREFIX ), NULL, 10 ) );
+
+   int fd                            = open( fileName, O_RDONLY );
+   if( fd < 0 ) return NULL;
+
+   struct stat st;
+   if( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) ){
+      close( fd );
+      return NULL;
+   }
+
+   // Calloc the mem to reset all vars to 0
+   tracePT traceP                    = (tracePT) calloc( 1, sizeof(traceT) );
+   ASSERT( !traceP, "Unable to create trace" );
+
+   snprintf( traceP->name, sizeof(traceP->name), "%s", fileName );
+   traceP->format                    = TRACE_FMT_TEXT;
+   traceP->fd                        = fd;
+   traceP->size                      = st.st_size;
+
+   // Compressed traces are streamed, not mapped
+   char magic[4];
+   if( pread( fd, magic, 4, 0 ) == 4 && memcmp( magic, TRACE_Z_MAGIC, 4 ) == 0 ){
+      traceZOpen( traceP );
+      return traceP;
+   }
+
+   // mmap can not map an empty file. Leave the cursor at NULL == end
+   if( traceP->size > 0 ){
+      void* mapP                     = mmap( NULL, traceP->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      if( mapP == MAP_FAILED ){
+         close( fd );
+         free( traceP );
+         return NULL;
+      }
+      // Trace is consumed front to back exactly once
+      posix_madvise( mapP, traceP->size, POSIX_MADV_SEQUENTIAL );
+      traceP->baseP                  = (char*) mapP;
+   }
+   traceP->curP                      = traceP->baseP;
+   traceP->endP                      = traceP->baseP + traceP->size;
+
+   // Pick the format by magic number
+   if( traceP->size >= 4 && memcmp( traceP->baseP, TRACE_BIN_MAGIC, 4 ) == 0 )
+      traceBinOpen( traceP );
+
+   return traceP;
+}
+
+// Decodes the next record. Returns FALSE at the end of trace
+boolean traceRead( tracePT traceP, traceRecPT recP )
+{
+   if( traceP->ringP != NULL ) return traceReadAsync( traceP, recP );
+   return traceReadSync( traceP, recP );
+}
+
+boolean traceReadSync( tracePT traceP, traceRecPT recP )
+{
+   switch( traceP->format ){
+      case TRACE_FMT_BIN  : return traceReadBin( traceP, recP );
+      case TRACE_FMT_Z    : return traceReadZ( traceP, recP );
+      case TRACE_FMT_MEM  : return traceReadMem( traceP, recP );
+      case TRACE_FMT_SYNTH: return traceReadSynthetic( traceP, recP );
+      default             : return traceReadText( traceP, recP );
+   }
+}
+
+boolean traceReadText( tracePT traceP, traceRecPT recP )
+{
+   traceSkipSpace( traceP );
+   if( traceP->curP >= traceP->endP ) return FALSE;
+
+   recP->pc                          = (addrT) traceParseHex( traceP );
+   recP->operation                   = traceParseDec( traceP );
+   recP->dst                         = traceParseDec( traceP );
+   recP->src1                        = traceParseDec( traceP );
+   recP->src2                        = traceParseDec( traceP );
+   recP->mem                         = (addrT) traceParseHex( traceP );
+   return TRUE;
+}
+
+//-------------- IN MEMORY BEGIN -------------
+
+// Decodes a whole trace, in any format traceOpen understands, into one
+// array. Returns NULL if the file can not be opened
+traceRecPT traceLoad( char* fileName, size_t* numRecsP )
+{
+   tracePT traceP                    = traceOpen( fileName );
+   if( !traceP ) return NULL;
+
+   // Binary traces know their length up front, the rest grow as needed
+   size_t capacity                   = ( traceP->format == TRACE_FMT_BIN ) ?
+                                       ( traceP->endP - traceP->curP ) / traceP->recSize + 1 : 65536;
+   traceRecPT recsP                  = (traceRecPT) malloc( capacity * sizeof(traceRecT) );
+   ASSERT( !recsP, "Unable to load trace %s", fileName );
+
+   size_t numRecs                    = 0;
+   while( TRUE ){
+      if( numRecs == capacity ){
+         capacity                   *= 2;
+         recsP                       = (traceRecPT) realloc( recsP, capacity * sizeof(traceRecT) );
+         ASSERT( !recsP, "Unable to load trace %s", fileName );
+      }
+      if( !traceReadSync( traceP, &recsP[ numRecs ] ) ) break;
+      numRecs++;
+   }
+   traceClose( traceP );
+
+   *numRecsP                         = numRecs;
+   return recsP;
+}
+
+// Reader over records loaded by traceLoad. The records stay owned by the caller
+tracePT traceOpenMem( traceRecPT recsP, size_t numRecs )
+{
+   // Calloc the mem to reset all vars to 0
+   tracePT traceP                    = (tracePT) calloc( 1, sizeof(traceT) );
+   ASSERT( !traceP, "Unable to create trace" );
+
+   snprintf( traceP->name, sizeof(traceP->name), "memory" );
+   traceP->format                    = TRACE_FMT_MEM;
+   traceP->fd                        = -1;
+   traceP->recsP                     = recsP;
+   traceP->numRecs                   = numRecs;
+   return traceP;
+}
+
+boolean traceReadMem( tracePT traceP, traceRecPT recP )
+{
+   if( traceP->nextRec >= traceP->numRecs ) return FALSE;
+   *recP                             = traceP->recsP[ traceP->nextRec++ ];
+   return TRUE;
+}
+
+//-------------- IN MEMORY END   -------------
+
+//-------------- SYNTHETIC BEGIN -------------
+
+// Generated trace of numRecs records, for runs longer than any trace on
+// disk. Every 4th record is a load. The loads cycle over
+// 2 * TRACE_SYNTH_BLOCKS blocks of 64 bytes, half of them 2^40 above the
+// other half. A 64 bit build therefore sees exactly that many distinct
+// blocks, and a 32 bit build sees half as many because the high bits are
+// cut off
+tracePT traceOpenSynthetic( unsigned long long numRecs )
+{
+   // Calloc the mem to reset all vars to 0
+   tracePT traceP                    = (tracePT) calloc( 1, sizeof(traceT) );
+   ASSERT( !traceP, "Unable to create trace" );
+
+   snprintf( traceP->name, sizeof(traceP->name), "%s%llu", TRACE_SYNTH_PREFIX, numRecs );
+   traceP->format                    = TRACE_FMT_SYNTH;
+   traceP->fd                        = -1;
+   traceP->synthRecs                 = numRecs;
+   return traceP;
+}
+
+boolean traceReadSynthetic( tracePT traceP, traceRecPT recP )
+{
+   if( traceP->synthNext >= traceP->synthRecs ) return FALSE;
+   unsigned long long i              = traceP->synthNext++;
+
+   recP->pc                          = (addrT) ( 0x400000 + ( i & 1023 ) * 4 );
+   recP->operation                   = ( ( i & 3 ) == 3 ) ? 2 : (int) ( i & 1 );
+   recP->dst                         = (int) ( i & 31 );
+   recP->src1                        = (int) ( ( i + 7 ) & 31 );
+   recP->src2                        = ( i & 4 ) ? -1 : (int) ( ( i + 13 ) & 31 );
+   recP->mem                         = 0;
+   if( recP->operation == 2 ){
+      unsigned long long load        = i >> 2;
+      unsigned long long high        = ( load & 1 ) << 40;
+      recP->mem                      = (addrT) (uaddrT) ( high + ( ( load >> 1 ) % TRACE_SYNTH_BLOCKS ) * 64 );
+   }
+   return TRUE;
+}
+
+//-------------- SYNTHETIC END   -------------
+
+//-------------- ASYNC BEGIN -------------------
+
+// Decoder thread. Fills the ring until end of trace or until the
+// consumer asks it to stop
+void* traceAsyncProducer( void* dataP )
+{
+   tracePT traceP                    = (tracePT) dataP;
+   traceRingPT ringP                 = traceP->ringP;
+   unsigned int head                 = 0;
+   unsigned int tail                 = 0;
+
+   while( TRUE ){
+      // Wait for a free slot. Re-read the consumer index only when the
+      // cached copy says the ring is full
+      while( head - tail > ringP->mask ){
+         if( __atomic_load_n( &ringP->stop, __ATOMIC_ACQUIRE ) ) return NULL;
+         tail                        = __atomic_load_n( &ringP->tail, __ATOMIC_ACQUIRE );
+         if( head - tail > ringP->mask ) sched_yield();
+      }
+      if( !traceReadSync( traceP, &ringP->recP[ head & ringP->mask ] ) ) break;
+      head++;
+      __atomic_store_n( &ringP->head, head, __ATOMIC_RELEASE );
+   }
+   __atomic_store_n( &ringP->done, TRUE, __ATOMIC_RELEASE );
+   return NULL;
+}
+
+// Moves decoding of the trace to a background thread. Records are handed
+// over in trace order, so readers see exactly what traceReadSync returns
+void traceAsyncStart( tracePT traceP )
+{
+   traceRingPT ringP                 = (traceRingPT) calloc( 1, sizeof(traceRingT) );
+   ASSERT( !ringP, "Unable to create trace ring" );
+   ringP->recP                       = (traceRecPT) calloc( TRACE_RING_SIZE, sizeof(traceRecT) );
+   ASSERT( !ringP->recP, "Unable to create trace ring" );
+   ringP->mask                       = TRACE_RING_SIZE - 1;
+
+   traceP->ringP                     = ringP;
+   ASSERT( pthread_create( &traceP->thread, NULL, traceAsyncProducer, traceP ) != 0,
+           "Unable to start trace decoder thread" );
+}
+
+boolean traceReadAsync( tracePT traceP, traceRecPT recP )
+{
+   traceRingPT ringP                 = traceP->ringP;
+   unsigned int tail                 = ringP->tail;
+   unsigned int head                 = ringP->cachedHead;
+
+   // Only touch the producer's line once the cached head says the ring
+   // is empty. done is published after the last head update, so a head
+   // read after done is seen is final
+   while( tail == head ){
+      boolean done                   = __atomic_load_n( &ringP->done, __ATOMIC_ACQUIRE );
+      head                           = __atomic_load_n( &ringP->head, __ATOMIC_ACQUIRE );
+      if( tail == head ){
+         if( done ) return FALSE;
+         sched_yield();
+      }
+   }
+   ringP->cachedHead                 = head;
+
+   *recP                             = ringP->recP[ tail & ringP->mask ];
+   __atomic_store_n( &ringP->tail, tail + 1, __ATOMIC_RELEASE );
+   return TRUE;
+}
+
+//-------------- ASYNC END   -------------------
+
+void traceClose( tracePT traceP )
+{
+   if( !traceP ) return;
+   if( traceP->ringP != NULL ){
+      __atomic_store_n( &traceP->ringP->stop, TRUE, __ATOMIC_RELEASE );
+      pthread_join( traceP->thread, NULL );
+      free( traceP->ringP->recP );
+      free( traceP->ringP );
+   }
+   if( traceP->baseP != NULL )
+      munmap( traceP->baseP, traceP->size );
+   free( traceP->blockP );
+   free( traceP->dictP );
+   if( traceP->fd >= 0 )
+      close( traceP->fd );
+   free( traceP );
+}
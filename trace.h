@@ -0,0 +1,212 @@
+/*H**********************************************************************
+* FILENAME    :       trace.h
+* DESCRIPTION :       Contains structures and prototypes for trace
+*                     readers feeding the dynamic scheduler
+* NOTES       :       -NA-
+*
+* AUTHOR      :       Utkarsh Mathur           START DATE :    10 Nov 17
+*
+* CHANGES :
+*
+*H***********************************************************************/
+
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "all.h"
+#include <pthread.h>
+
+// Pointer translations
+typedef  struct  _traceT              *tracePT;
+typedef  struct  _traceRecT           *traceRecPT;
+typedef  struct  _traceZDictT         *traceZDictPT;
+typedef  struct  _traceZWriterT       *traceZWriterPT;
+typedef  struct  _traceRingT          *traceRingPT;
+
+// Binary trace layout (all fields little-endian)
+//    header : magic[4] = "DSTB", u16 version, u16 flags, u64 numRecords
+//    record : pc (u32 or u64), u8 op, s8 dst, s8 src1, s8 src2, mem (u32 or u64)
+// numRecords is 0 if the writer could not seek back to fill it in
+#define   TRACE_BIN_MAGIC              "DSTB"
+#define   TRACE_BIN_VERSION            1
+#define   TRACE_BIN_HEADER_SIZE        16
+#define   TRACE_BIN_FLAG_PC64          0x1
+#define   TRACE_BIN_FLAG_MEM64         0x2
+
+// Compressed trace layout
+//    header : magic[4] = "DSTZ", u16 version, u16 flags, u64 numRecords
+//    block  : u32 numRecords, u32 numBytes, numBytes of encoded records
+// Every block starts with an empty dictionary, so blocks decode on their
+// own and the reader only ever holds one block in memory.
+// Each record starts with a flag byte:
+//    TRACE_Z_PC_SEQ     pc is previous pc + 4, else zigzag varint of (pc - (prev pc + 4))
+//    TRACE_Z_REGS_HIT   op/dst/src1/src2 same as the last time this pc was seen,
+//                       else 4 raw bytes
+//    TRACE_Z_MEM_ZERO   mem is 0
+//    TRACE_Z_MEM_STRIDE mem is last mem of this pc + last stride of this pc
+//    otherwise          zigzag varint of (mem - last mem of this pc)
+#define   TRACE_Z_MAGIC                "DSTZ"
+#define   TRACE_Z_VERSION              1
+#define   TRACE_Z_BLOCK_RECS           65536
+// Worst case encoding of a record: flag + 2 varints + 4 register bytes
+#define   TRACE_Z_MAX_REC_BYTES        ( 1 + 10 + 4 + 10 )
+#define   TRACE_Z_DICT_SIZE            4096
+#define   TRACE_Z_PC_SEQ               0x1
+#define   TRACE_Z_REGS_HIT             0x2
+#define   TRACE_Z_MEM_ZERO             0x4
+#define   TRACE_Z_MEM_STRIDE           0x8
+
+// Enum to hold the on disk format of a trace
+typedef enum{
+   TRACE_FMT_TEXT                           = 0,      /* pc op dst src1 src2 mem */
+   TRACE_FMT_BIN                            = 1,      /* Fixed width records, see above */
+   TRACE_FMT_Z                              = 2,      /* Block compressed, see above */
+   TRACE_FMT_MEM                            = 3,      /* Already decoded records in memory */
+   TRACE_FMT_SYNTH                          = 4,      /* Generated, see traceReadSynthetic */
+}traceFormatT;
+
+// Trace file names starting with this are generated, not read
+#define   TRACE_SYNTH_PREFIX           "synth:"
+// Working set of the synthetic trace: blocks of 64 bytes per half, the
+// two halves differ only in bit 40, which only 64 bit addresses keep
+#define   TRACE_SYNTH_BLOCKS           64
+
+// One decoded trace record
+typedef struct _traceRecT{
+   addrT               pc;
+   int                 operation;
+   int                 dst;
+   int                 src1;
+   int                 src2;
+   addrT               mem;
+}traceRecT;
+
+// Per pc history shared by the compressor and decompressor
+typedef struct _traceZDictT{
+   boolean             valid;
+   addrT               pc;
+   int                 operation;
+   int                 dst;
+   int                 src1;
+   int                 src2;
+   addrT               lastMem;
+   addrT               stride;
+}traceZDictT;
+
+// Compressed trace writer
+typedef struct _traceZWriterT{
+   FILE*               fp;
+   unsigned long long  numRecords;
+
+   // Block under construction
+   unsigned char*      blockP;
+   int                 blockBytes;
+   int                 blockRecs;
+   addrT               prevPc;
+   traceZDictT         dict[TRACE_Z_DICT_SIZE];
+}traceZWriterT;
+
+// Number of pre-decoded records between the decoder thread and fetch
+#define   TRACE_RING_SIZE              16384
+
+// Single producer/single consumer ring of decoded records. head is only
+// written by the decoder thread and tail only by the consumer, so no lock
+// is needed. Both sit on their own cache line to avoid false sharing.
+// The consumer keeps its last view of head next to tail and only goes
+// back to the producer's line when that view shows the ring empty
+typedef struct _traceRingT{
+   traceRecT*          recP;
+   unsigned int        mask;
+   char                pad0[64];
+   // Producer side
+   unsigned int        head;
+   boolean             done;
+   char                pad1[64];
+   // Consumer side
+   unsigned int        tail;
+   unsigned int        cachedHead;
+   boolean             stop;
+   char                pad2[64];
+}traceRingT;
+
+// Generic trace source
+typedef struct _traceT{
+   // Placeholder for file name
+   char                name[128];
+   traceFormatT        format;
+   int                 fd;
+
+   // Memory mapped view of the file
+   char*               baseP;
+   char*               curP;
+   char*               endP;
+   size_t              size;
+
+   // Only for binary traces
+   int                 flags;
+   int                 recSize;
+
+   // Only for compressed traces. curP/endP walk the current block
+   unsigned char*      blockP;
+   int                 blockRecs;
+   addrT               prevPc;
+   traceZDictPT        dictP;
+
+   // Only for asynchronous decoding
+   traceRingPT         ringP;
+   pthread_t           thread;
+
+   // Only for in memory traces. The records are read only and may be
+   // shared by any number of readers, each with its own traceT cursor
+   traceRecPT          recsP;
+   size_t              numRecs;
+   size_t              nextRec;
+
+   // Only for synthetic traces
+   unsigned long long  synthRecs;
+   unsigned long long  synthNext;
+}traceT;
+
+tracePT    traceOpen( char* fileName );
+boolean    traceRead( tracePT traceP, traceRecPT recP );
+void       traceClose( tracePT traceP );
+traceRecPT traceLoad( char* fileName, size_t* numRecsP );
+tracePT    traceOpenMem( traceRecPT recsP, size_t numRecs );
+boolean    traceReadMem( tracePT traceP, traceRecPT recP );
+tracePT    traceOpenSynthetic( unsigned long long numRecs );
+boolean    traceReadSynthetic( tracePT traceP, traceRecPT recP );
+void       traceAsyncStart( tracePT traceP );
+boolean    traceReadSync( tracePT traceP, traceRecPT recP );
+boolean    traceReadAsync( tracePT traceP, traceRecPT recP );
+void*      traceAsyncProducer( void* dataP );
+int        traceLineNum( tracePT traceP );
+void       traceSkipSpace( tracePT traceP );
+uaddrT     traceParseHex( tracePT traceP );
+int        traceParseDec( tracePT traceP );
+boolean    traceReadText( tracePT traceP, traceRecPT recP );
+boolean    traceReadBin( tracePT traceP, traceRecPT recP );
+void       traceBinOpen( tracePT traceP );
+unsigned int traceGetU16( unsigned char* p );
+unsigned int traceGetU32( unsigned char* p );
+unsigned long long traceGetU64( unsigned char* p );
+void       tracePutU( FILE* fp, unsigned long long value, int numBytes );
+boolean    traceReadZ( tracePT traceP, traceRecPT recP );
+void       traceZOpen( tracePT traceP );
+boolean    traceZReadBlock( tracePT traceP );
+traceZDictPT traceZDictLookup( traceZDictPT dictP, addrT pc );
+void       traceZDictUpdate( traceZDictPT entryP, traceRecPT recP );
+traceZWriterPT traceZWriterOpen( FILE* fp );
+void       traceZWrite( traceZWriterPT writerP, traceRecPT recP );
+void       traceZFlushBlock( traceZWriterPT writerP );
+void       traceZWriterClose( traceZWriterPT writerP );
+unsigned long long traceZigZag( addrT value );
+addrT      traceUnZigZag( unsigned long long value );
+unsigned char* tracePutVarint( unsigned char* p, unsigned long long value );
+unsigned long long traceGetVarint( tracePT traceP );
+size_t     traceReadFully( int fd, void* bufP, size_t numBytes );
+int        traceBinRecSize( int flags );
+void       traceBinWriteHeader( FILE* fp, int flags, unsigned long long numRecords );
+void       traceBinWriteRec( FILE* fp, int flags, traceRecPT recP );
+
+#endif